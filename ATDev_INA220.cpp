@@ -27,9 +27,24 @@
 #include "Arduino.h"
 
 #include <Wire.h>
+#include <new>
 
 #include "ATDev_INA220.h"
 
+/** steps of an asynchronous read, see poll() **/
+enum {
+  ASYNC_IDLE,           // no read in progress
+  ASYNC_BUS,            // reading the bus voltage and CNVR/OVF
+  ASYNC_CAL_WRITE,      // rewriting the calibration (tracking off)
+  ASYNC_CAL_CHECK,      // reading back the calibration (tracking on)
+  ASYNC_CAL_RESTORE,    // restoring a lost calibration
+  ASYNC_CONFIG_RESTORE, // restoring the config after a lost calibration
+  ASYNC_SHUNT,          // reading the shunt voltage
+  ASYNC_CURRENT,        // reading the current
+  ASYNC_POWER,          // reading the power, clears CNVR
+  ASYNC_RANGE,          // switching the shunt gain when auto-ranging
+};
+
 /*!
  *  @brief  Instantiates a new INA220 class
  *  @param addr the I2C address the device can be found on. Default is 0x40
@@ -38,12 +53,44 @@ ATDev_INA220::ATDev_INA220(uint8_t addr) {
   INA220_i2caddr = addr;
   INA220_currentDivider_mA = 0;
   INA220_powerMultiplier_mW = 0.0f;
+  INA220_currentLSB_nA = 0;
+  INA220_calValue = 0;
+  INA220_config = INA220_CONFIG_BVOLTAGERANGE_32V | INA220_CONFIG_GAIN_8_320MV |
+                  INA220_CONFIG_BADCRES_12BIT |
+                  INA220_CONFIG_SADCRES_12BIT_1S_532US |
+                  INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
+  _calTracking = false;
+  _calLastReadZero = false;
+  _calVerifyInterval = 0;
+  _calReadsSinceVerify = 0;
+  _streamingReads = false;
+  _lastPointer = INA220_POINTER_UNKNOWN;
+  _autoRange = false;
+  // The power-on config uses the 320mV range
+  _dataRange = 3;
+  _rangePending = false;
+  _rangeSwitch_us = 0;
+  _asyncState = ASYNC_IDLE;
+  _asyncResume = ASYNC_IDLE;
+  _asyncOnlyIfReady = false;
+  _asyncPointerSent = false;
+  _asyncStatus = INA220_STATUS_OK;
+  _flags = 0;
+  _status = INA220_STATUS_OK;
+  _lastError = INA220_STATUS_OK;
+  _retries = 0;
+  resetBusStats();
+  resetClipStats();
 }
 
 /*!
  *  @brief INA220 class destructor
  */
-ATDev_INA220::~ATDev_INA220() { delete i2c_dev; }
+ATDev_INA220::~ATDev_INA220() {
+  if (i2c_dev) {
+    i2c_dev->~Adafruit_I2CDevice();
+  }
+}
 
 /*!
  *  @brief  Sets up the HW (defaults to 32V and 2A for calibration values)
@@ -51,17 +98,631 @@ ATDev_INA220::~ATDev_INA220() { delete i2c_dev; }
  *  @return true: success false: Failed to start I2C
  */
 bool ATDev_INA220::begin(TwoWire *theWire) {
-  if (!i2c_dev) {
-    i2c_dev = new Adafruit_I2CDevice(INA220_i2caddr, theWire);
+  if (!beginDevice(theWire)) {
+    return false;
   }
+  init();
+  return true;
+}
+
+/*!
+ *  @brief  Sets up the I2C device without touching the chip's registers.
+ *          Starts the operation for begin(), so its status and bus
+ *          statistics include the address check.
+ *  @param theWire the TwoWire object to use
+ *  @return true: success false: Failed to start I2C
+ */
+bool ATDev_INA220::beginDevice(TwoWire *theWire) {
+  startOperation();
+  if (i2c_dev) {
+    // Called again, maybe with a new address or bus
+    i2c_dev->~Adafruit_I2CDevice();
+  }
+  i2c_dev = new (_i2cStorage) Adafruit_I2CDevice(INA220_i2caddr, theWire);
 
   if (!i2c_dev->begin()) {
+    // The device didn't acknowledge its address
+    _busStats.nacks++;
+    _status = INA220_STATUS_NACK;
     return false;
   }
-  init();
   return true;
 }
 
+/*!
+ *  @brief  Reads shunt voltage, bus voltage, current and power in one call
+ *  @param  snapshot filled with the raw and scaled readings and the
+ *          INA220_SAMPLE_* flags, including overflow and saturation
+ *  @return true: all registers were read false: a bus operation failed
+ *  @note   The INA220 has no register auto-increment, so this costs one
+ *          pointer write and one 2-byte read per register, but the
+ *          calibration is handled once for the whole snapshot. The bus
+ *          voltage is read first since reading POWER clears CNVR.
+ */
+bool ATDev_INA220::readAll(Snapshot &snapshot) {
+  return readSnapshot(snapshot, false);
+}
+
+/*!
+ *  @brief  Reads a new snapshot only if a conversion completed since the
+ *          last one. The bus voltage register is read first; if its CNVR
+ *          flag is clear, no other register is read.
+ *  @param  snapshot on new data, filled like readAll(). Otherwise only the
+ *          bus voltage and flags (including OVF) are updated.
+ *  @return true: a new conversion was read false: no new data, or a bus
+ *          operation failed (check success())
+ *  @note   Reading POWER clears CNVR, so every conversion is returned
+ *          exactly once. With streaming reads enabled, polling while no
+ *          conversion is ready costs one 2-byte read per call.
+ */
+bool ATDev_INA220::pollSample(Snapshot &snapshot) {
+  return readSnapshot(snapshot, true) &&
+         (snapshot.flags & INA220_SAMPLE_CNVR);
+}
+
+/*!
+ *  @brief  Starts an asynchronous read of a snapshot, to be completed by
+ *          calling poll() until it stops returning INA220_ASYNC_PENDING.
+ *          Aborts a read that is still in progress.
+ *  @param  onlyIfReady true to stop after the bus voltage when no new
+ *          conversion is ready, like pollSample()
+ */
+void ATDev_INA220::startRead(bool onlyIfReady) {
+  startOperation();
+  _asyncStatus = INA220_STATUS_OK;
+  _asyncOnlyIfReady = onlyIfReady;
+  asyncEnter(ASYNC_BUS);
+}
+
+/*!
+ *  @brief  Advances the read started by startRead() by one bus
+ *          transaction, a pointer write or a 2-byte read, so the caller
+ *          can do other work between the steps of a snapshot
+ *  @param  snapshot the snapshot being filled. Pass the same snapshot to
+ *          every poll() of one read.
+ *  @return INA220_ASYNC_PENDING: call poll() again INA220_ASYNC_READY: the
+ *          snapshot is complete, as from readAll() or pollSample()
+ *          INA220_ASYNC_ERROR: a bus operation failed or no read was
+ *          started
+ *  @note   Other calls on the same device may be made between steps; a
+ *          pointer they moved is written again before the next read, and
+ *          their status doesn't change the read's.
+ */
+INA220_AsyncStatus ATDev_INA220::poll(Snapshot &snapshot) {
+  uint16_t value;
+
+  // Blocking calls between the steps start operations of their own
+  _status = _asyncStatus;
+
+  switch (_asyncState) {
+  case ASYNC_BUS:
+    if (!asyncRead(INA220_REG_BUSVOLTAGE, &value)) {
+      break;
+    }
+    decodeBusVoltage(snapshot, value);
+    if (_asyncOnlyIfReady && !(value & INA220_BUSVOLTAGE_CNVR)) {
+      asyncEnter(ASYNC_IDLE);
+      return INA220_ASYNC_READY;
+    }
+    if (!_calTracking) {
+      asyncEnter(ASYNC_CAL_WRITE);
+    } else if (calibrationCheckDue()) {
+      _asyncResume = ASYNC_SHUNT;
+      asyncEnter(ASYNC_CAL_CHECK);
+    } else {
+      asyncEnter(ASYNC_SHUNT);
+    }
+    return INA220_ASYNC_PENDING;
+
+  case ASYNC_CAL_WRITE:
+    asyncWrite(INA220_REG_CALIBRATION, INA220_calValue);
+    asyncEnter(ASYNC_SHUNT);
+    break;
+
+  case ASYNC_CAL_CHECK:
+    _calReadsSinceVerify = 0;
+    if (!asyncRead(INA220_REG_CALIBRATION, &value)) {
+      break;
+    }
+    if (value == INA220_calValue) {
+      asyncEnter(_asyncResume);
+    } else {
+      asyncEnter(ASYNC_CAL_RESTORE);
+    }
+    return INA220_ASYNC_PENDING;
+
+  case ASYNC_CAL_RESTORE:
+    asyncWrite(INA220_REG_CALIBRATION, INA220_calValue);
+    asyncEnter(ASYNC_CONFIG_RESTORE);
+    break;
+
+  case ASYNC_CONFIG_RESTORE:
+    asyncWrite(INA220_REG_CONFIG, INA220_config);
+    _calLastReadZero = false;
+    // Read the current again if it was its drop to zero that found the
+    // lost calibration, like readAll()
+    if (_asyncResume == ASYNC_POWER) {
+      asyncEnter(ASYNC_CURRENT);
+    } else {
+      asyncEnter(_asyncResume);
+    }
+    break;
+
+  case ASYNC_SHUNT:
+    if (!asyncRead(INA220_REG_SHUNTVOLTAGE, &value)) {
+      break;
+    }
+    snapshot.shuntVoltage_raw = value;
+    asyncEnter(ASYNC_CURRENT);
+    return INA220_ASYNC_PENDING;
+
+  case ASYNC_CURRENT:
+    if (!asyncRead(INA220_REG_CURRENT, &value)) {
+      break;
+    }
+    snapshot.current_raw = value;
+    if (calibrationSuspect(value)) {
+      _asyncResume = ASYNC_POWER;
+      asyncEnter(ASYNC_CAL_CHECK);
+    } else {
+      asyncEnter(ASYNC_POWER);
+    }
+    return INA220_ASYNC_PENDING;
+
+  case ASYNC_POWER:
+    if (!asyncRead(INA220_REG_POWER, &value)) {
+      break;
+    }
+    snapshot.power_raw = value;
+    scaleSnapshot(snapshot);
+    if (_autoRange && !_rangePending &&
+        autoRangeGain(snapshot.shuntVoltage_raw) !=
+            (INA220_config & INA220_CONFIG_GAIN_MASK)) {
+      asyncEnter(ASYNC_RANGE);
+      return INA220_ASYNC_PENDING;
+    }
+    asyncEnter(ASYNC_IDLE);
+    return INA220_ASYNC_READY;
+
+  case ASYNC_RANGE:
+    INA220_config = (INA220_config & ~INA220_CONFIG_GAIN_MASK) |
+                    autoRangeGain(snapshot.shuntVoltage_raw);
+    asyncWrite(INA220_REG_CONFIG, INA220_config);
+    asyncEnter(ASYNC_IDLE);
+    if (!_success) {
+      return INA220_ASYNC_ERROR;
+    }
+    return INA220_ASYNC_READY;
+
+  default:
+    return INA220_ASYNC_ERROR;
+  }
+
+  if (!_success) {
+    asyncEnter(ASYNC_IDLE);
+    return INA220_ASYNC_ERROR;
+  }
+  return INA220_ASYNC_PENDING;
+}
+
+/*!
+ *  @brief  Moves the asynchronous read to its next step
+ *  @param  state the step, one of the ASYNC_* values
+ */
+void ATDev_INA220::asyncEnter(uint8_t state) {
+  _asyncState = state;
+  _asyncPointerSent = false;
+}
+
+/*!
+ *  @brief  Performs one transaction of an asynchronous register read: the
+ *          pointer write if the chip may not point at the register, the
+ *          data read otherwise
+ *  @param  reg the register address
+ *  @param  value set to the register contents once read
+ *  @return true: the value was read false: the pointer was written, a read
+ *          without it has to be repeated (see streamSuspect()) or a bus
+ *          operation failed (check _success)
+ */
+bool ATDev_INA220::asyncRead(uint8_t reg, uint16_t *value) {
+  if (_lastPointer != reg || !(_asyncPointerSent || _streamingReads)) {
+    _success = writePointer(reg);
+    _asyncPointerSent = true;
+  } else {
+    _success = readData(value);
+    if (_success && !_asyncPointerSent && streamSuspect(reg, *value)) {
+      // Write the pointer in the next step and read again
+      _lastPointer = INA220_POINTER_UNKNOWN;
+      return false;
+    }
+    if (_success) {
+      if (reg == INA220_REG_BUSVOLTAGE) {
+        noteBusVoltage(*value);
+      }
+      return true;
+    }
+  }
+  // Steps aren't retried so each poll() stays one transaction; the
+  // caller restarts the read instead
+  if (!_success) {
+    asyncFailed();
+  }
+  return false;
+}
+
+/*!
+ *  @brief  Performs the register write of an asynchronous step, without
+ *          retries like asyncRead()
+ *  @param  reg the register address
+ *  @param  value the value to write
+ *  @return true: success false: the bus operation failed
+ */
+bool ATDev_INA220::asyncWrite(uint8_t reg, uint16_t value) {
+  _success = writeRegisterOnce(reg, value);
+  if (!_success) {
+    asyncFailed();
+  }
+  return _success;
+}
+
+/*!
+ *  @brief  Records a failed step as the status of the asynchronous read,
+ *          which getStatus() reports after each poll()
+ */
+void ATDev_INA220::asyncFailed() {
+  operationFailed();
+  _asyncStatus = _status;
+}
+
+/*!
+ *  @brief  Sets the bus voltage ADC resolution and averaging
+ *  @param  resolution one of the INA220_CONFIG_BADCRES_* values
+ */
+void ATDev_INA220::setBusADCResolution(INA220_BusADCResolution resolution) {
+  startOperation();
+  INA220_config = (INA220_config & ~INA220_CONFIG_BADCRES_MASK) |
+                  (resolution & INA220_CONFIG_BADCRES_MASK);
+  _success = writeRegister(INA220_REG_CONFIG, INA220_config);
+}
+
+/*!
+ *  @brief  Sets the shunt voltage ADC resolution and averaging
+ *  @param  resolution one of the INA220_CONFIG_SADCRES_* values
+ */
+void ATDev_INA220::setShuntADCResolution(
+    INA220_ShuntADCResolution resolution) {
+  startOperation();
+  INA220_config = (INA220_config & ~INA220_CONFIG_SADCRES_MASK) |
+                  (resolution & INA220_CONFIG_SADCRES_MASK);
+  _success = writeRegister(INA220_REG_CONFIG, INA220_config);
+}
+
+/*!
+ *  @brief  Sets the shunt voltage PGA gain. The current LSB and the
+ *          calibration don't depend on the gain, so they are kept.
+ *  @param  gain one of the INA220_CONFIG_GAIN_* values
+ *  @note   Shunt voltages above the new range read as the range limit.
+ */
+void ATDev_INA220::setGain(INA220_ShuntGain gain) {
+  startOperation();
+  applyGain(gain);
+}
+
+/*!
+ *  @brief  Writes a new gain as part of the current operation
+ *  @param  gain one of the INA220_CONFIG_GAIN_* values
+ */
+void ATDev_INA220::applyGain(INA220_ShuntGain gain) {
+  INA220_config = (INA220_config & ~INA220_CONFIG_GAIN_MASK) |
+                  (gain & INA220_CONFIG_GAIN_MASK);
+  _success = writeRegister(INA220_REG_CONFIG, INA220_config);
+}
+
+/*!
+ *  @brief  Enables or disables auto-ranging. When enabled every snapshot
+ *          read with readAll(), pollSample() or poll() checks its shunt
+ *          voltage and switches the gain for the next conversion: up a
+ *          range when the reading is within 1/8 of full scale, down a
+ *          range when it is below 3/8 of full scale, i.e. comfortably
+ *          inside the lower range. Each switch is a single config write.
+ *          Snapshot::range tells which range a sample was taken with;
+ *          samples read before the first conversion with the new gain
+ *          keep the old range and don't switch again.
+ *  @param  enable true to enable auto-ranging
+ *  @note   The current LSB doesn't depend on the gain, so the calibration
+ *          and the scaling of current and power stay the same across
+ *          switches; only the shunt voltage resolution changes.
+ */
+void ATDev_INA220::setAutoRange(bool enable) { _autoRange = enable; }
+
+/*!
+ *  @brief  Picks the gain for the next conversion from a shunt reading
+ *  @param  shunt the raw shunt voltage, taken with the current gain
+ *  @return the gain to use, the current one if it fits the reading
+ */
+INA220_ShuntGain ATDev_INA220::autoRangeGain(int16_t shunt) {
+  uint8_t range =
+      (INA220_config & INA220_CONFIG_GAIN_MASK) >> INA220_CONFIG_GAIN_SHIFT;
+  int32_t fullScale = (int32_t)INA220_SHUNT_FULLSCALE_40MV << range;
+  int32_t magnitude = shunt < 0 ? -(int32_t)shunt : shunt;
+
+  // The thresholds leave a gap between ranges so a reading near a
+  // boundary doesn't make the gain toggle on every sample
+  if (range < 3 && magnitude >= fullScale - fullScale / 8) {
+    range++;
+  } else if (range > 0 && magnitude < fullScale * 3 / 8) {
+    range--;
+  }
+  return (INA220_ShuntGain)(range << INA220_CONFIG_GAIN_SHIFT);
+}
+
+/*!
+ *  @brief  Gets the shunt range of the results in the chip's registers.
+ *          After a gain switch that is the old range until a conversion
+ *          with the new gain completed: until a bus voltage read shows
+ *          CNVR, or a conversion time has passed since the switch.
+ *  @return the range, 0..3 for 40mV..320mV
+ */
+uint8_t ATDev_INA220::dataRange() {
+  if (_rangePending && micros() - _rangeSwitch_us >= getConversionTime_us()) {
+    _dataRange =
+        (INA220_config & INA220_CONFIG_GAIN_MASK) >> INA220_CONFIG_GAIN_SHIFT;
+    _rangePending = false;
+  }
+  return _dataRange;
+}
+
+/*!
+ *  @brief  Tracks gain switches for dataRange(): a config write restarts
+ *          the conversion, the registers keep the previous results
+ *  @param  config the config word written
+ */
+void ATDev_INA220::noteConfigWrite(uint16_t config) {
+  uint8_t range =
+      (config & INA220_CONFIG_GAIN_MASK) >> INA220_CONFIG_GAIN_SHIFT;
+
+  _rangePending = range != dataRange();
+  _rangeSwitch_us = micros();
+}
+
+/*!
+ *  @brief  Gets the conversion time of one ADC setting
+ *  @param  setting the 4-bit BADC or SADC field of the config register
+ *  @return the conversion time in microseconds
+ */
+static uint32_t adcConversionTime_us(uint8_t setting) {
+  static const uint32_t averaged_us[] = {532,  1060,  2130,  4260,
+                                         8510, 17020, 34050, 68100};
+  static const uint16_t single_us[] = {84, 148, 276, 532};
+
+  if (setting & 0x08) {
+    return averaged_us[setting & 0x07];
+  }
+  return single_us[setting & 0x03];
+}
+
+/*!
+ *  @brief  Gets the time between two conversion results (CNVR being set)
+ *          for the current mode and ADC settings
+ *  @return the conversion period in microseconds, 0 if the ADC is off
+ */
+uint32_t ATDev_INA220::getConversionTime_us() {
+  uint32_t bus_us = adcConversionTime_us((INA220_config >> 7) & 0x0F);
+  uint32_t shunt_us = adcConversionTime_us((INA220_config >> 3) & 0x0F);
+
+  switch (INA220_config & INA220_CONFIG_MODE_MASK) {
+  case INA220_CONFIG_MODE_SVOLT_TRIGGERED:
+  case INA220_CONFIG_MODE_SVOLT_CONTINUOUS:
+    return shunt_us;
+  case INA220_CONFIG_MODE_BVOLT_TRIGGERED:
+  case INA220_CONFIG_MODE_BVOLT_CONTINUOUS:
+    return bus_us;
+  case INA220_CONFIG_MODE_SANDBVOLT_TRIGGERED:
+  case INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS:
+    return shunt_us + bus_us;
+  default:
+    return 0;
+  }
+}
+
+/*!
+ *  @brief  Starts a single-shot conversion. The chip converts once and
+ *          then leaves the ADC idle until the next trigger.
+ *  @param  mode one of INA220_CONFIG_MODE_SVOLT_TRIGGERED,
+ *          INA220_CONFIG_MODE_BVOLT_TRIGGERED or
+ *          INA220_CONFIG_MODE_SANDBVOLT_TRIGGERED
+ *  @return true: conversion started false: invalid mode or bus error
+ *  @note   Writing the mode also clears CNVR, so waitForConversion()
+ *          completes only for this conversion.
+ */
+bool ATDev_INA220::triggerConversion(uint8_t mode) {
+  startOperation();
+  if (mode < INA220_CONFIG_MODE_SVOLT_TRIGGERED ||
+      mode > INA220_CONFIG_MODE_SANDBVOLT_TRIGGERED) {
+    return false;
+  }
+
+  INA220_config = (INA220_config & ~INA220_CONFIG_MODE_MASK) | mode;
+  _success = writeRegister(INA220_REG_CONFIG, INA220_config);
+  return _success;
+}
+
+/*!
+ *  @brief  Waits until the conversion started by triggerConversion() has
+ *          completed, i.e. until CNVR is set
+ *  @param  timeout_ms how long to wait before giving up
+ *  @return true: conversion complete, read it with readAll() false: timed
+ *          out or a bus operation failed (check success())
+ */
+bool ATDev_INA220::waitForConversion(uint32_t timeout_ms) {
+  uint32_t start = millis();
+  uint16_t bus;
+
+  startOperation();
+  while (true) {
+    _success = readRegister(INA220_REG_BUSVOLTAGE, &bus);
+    if (!_success) {
+      return false;
+    }
+    if (bus & INA220_BUSVOLTAGE_CNVR) {
+      return true;
+    }
+    if (millis() - start >= timeout_ms) {
+      return false;
+    }
+    delay(1);
+  }
+}
+
+/*!
+ *  @brief  Reads the bus voltage register and, unless onlyIfReady is set
+ *          and no conversion is ready, the other measurement registers
+ *  @param  snapshot the snapshot to fill
+ *  @param  onlyIfReady true to stop after the bus voltage when CNVR is
+ *          clear
+ *  @return true: success false: a bus operation failed
+ */
+bool ATDev_INA220::readSnapshot(Snapshot &snapshot, bool onlyIfReady) {
+  uint16_t bus = 0, shunt = 0, current = 0, power = 0;
+
+  startOperation();
+  _success = readRegister(INA220_REG_BUSVOLTAGE, &bus);
+  if (!_success) {
+    return false;
+  }
+
+  decodeBusVoltage(snapshot, bus);
+  if (onlyIfReady && !(bus & INA220_BUSVOLTAGE_CNVR)) {
+    return true;
+  }
+
+  refreshCalibration();
+
+  _success = readRegister(INA220_REG_SHUNTVOLTAGE, &shunt) &&
+             readRegister(INA220_REG_CURRENT, &current);
+  if (_success && calibrationLost(current)) {
+    _success = readRegister(INA220_REG_CURRENT, &current);
+  }
+  _success = _success && readRegister(INA220_REG_POWER, &power);
+
+  snapshot.shuntVoltage_raw = shunt;
+  snapshot.current_raw = current;
+  snapshot.power_raw = power;
+  scaleSnapshot(snapshot);
+
+  // Results still from before a gain switch don't decide the next one
+  if (_success && _autoRange && !_rangePending) {
+    INA220_ShuntGain gain = autoRangeGain(snapshot.shuntVoltage_raw);
+    if (gain != (INA220_config & INA220_CONFIG_GAIN_MASK)) {
+      applyGain(gain);
+    }
+  }
+  return _success;
+}
+
+/*!
+ *  @brief  Extracts the CNVR and OVF flags of the bus voltage register
+ *  @param  bus the bus voltage register value
+ *  @return INA220_SAMPLE_CNVR and INA220_SAMPLE_OVF as set in the register
+ */
+static uint8_t busFlags(uint16_t bus) {
+  uint8_t flags = 0;
+
+  if (bus & INA220_BUSVOLTAGE_CNVR) {
+    flags |= INA220_SAMPLE_CNVR;
+  }
+  if (bus & INA220_BUSVOLTAGE_OVF) {
+    flags |= INA220_SAMPLE_OVF;
+  }
+  return flags;
+}
+
+/*!
+ *  @brief  Fills the bus voltage and flags of a snapshot
+ *  @param  snapshot the snapshot to fill
+ *  @param  bus the bus voltage register value
+ */
+void ATDev_INA220::decodeBusVoltage(Snapshot &snapshot, uint16_t bus) {
+  snapshot.busVoltage_raw = (int16_t)((bus >> 3) * 4);
+  snapshot.busVoltage_V = snapshot.busVoltage_raw * 0.001;
+  snapshot.flags = busFlags(bus);
+}
+
+/*!
+ *  @brief  Fills the scaled shunt voltage, current and power of a snapshot
+ *          from its raw values, and the shunt range they were taken with
+ *  @param  snapshot the snapshot to fill
+ */
+void ATDev_INA220::scaleSnapshot(Snapshot &snapshot) {
+  snapshot.range = dataRange();
+  snapshot.shuntVoltage_mV = snapshot.shuntVoltage_raw * 0.01;
+  scaleCurrentPower(snapshot);
+
+  snapshot.flags |=
+      saturationFlags(snapshot.shuntVoltage_raw, snapshot.current_raw,
+                      snapshot.power_raw);
+  noteFlags(0xFF, snapshot.flags);
+}
+
+/*!
+ *  @brief  Fills the scaled current and power of a snapshot from its raw
+ *          values with the active calibration
+ *  @param  snapshot the snapshot to fill
+ */
+void ATDev_INA220::scaleCurrentPower(Snapshot &snapshot) {
+  snapshot.current_mA = snapshot.current_raw / INA220_currentDivider_mA;
+  snapshot.power_mW = snapshot.power_raw * INA220_powerMultiplier_mW;
+}
+
+/*!
+ *  @brief  Checks readings for saturation. Saturated readings only give a
+ *          lower bound of the real value.
+ *  @param  shunt the raw shunt voltage, taken with the gain of the results
+ *          in the chip's registers, see dataRange()
+ *  @param  current the raw current
+ *  @param  power the raw power
+ *  @return the INA220_SAMPLE_*_SAT flags of the saturated readings
+ */
+uint8_t ATDev_INA220::saturationFlags(int16_t shunt, int16_t current,
+                                      uint16_t power) {
+  int16_t fullScale = INA220_SHUNT_FULLSCALE_40MV << dataRange();
+  uint8_t flags = 0;
+
+  if (shunt >= fullScale || shunt <= -fullScale) {
+    flags |= INA220_SAMPLE_SHUNT_SAT;
+  }
+  if (current == 32767 || current == -32768) {
+    flags |= INA220_SAMPLE_CURRENT_SAT;
+  }
+  if (power == 0xFFFF) {
+    flags |= INA220_SAMPLE_POWER_SAT;
+  }
+  return flags;
+}
+
+/*!
+ *  @brief  Records the flags of a reading and counts the clipped ones
+ *  @param  mask the flags the reading can set, the others are kept
+ *  @param  flags the INA220_SAMPLE_* flags of the reading
+ */
+void ATDev_INA220::noteFlags(uint8_t mask, uint8_t flags) {
+  flags &= mask;
+  _flags = (_flags & ~mask) | flags;
+
+  if (flags & INA220_SAMPLE_OVF) {
+    _clipStats.overflows++;
+  }
+  if (flags & INA220_SAMPLE_SHUNT_SAT) {
+    _clipStats.shuntSaturations++;
+  }
+  if (flags & INA220_SAMPLE_CURRENT_SAT) {
+    _clipStats.currentSaturations++;
+  }
+  if (flags & INA220_SAMPLE_POWER_SAT) {
+    _clipStats.powerSaturations++;
+  }
+}
+
 /*!
  *  @brief  Configures to INA220 to be able to measure up to 32V and 2A
  *          of current.  Each unit of current corresponds to 100uA, and
@@ -70,6 +731,8 @@ bool ATDev_INA220::begin(TwoWire *theWire) {
  *  @note   These calculations assume a 0.1 ohm resistor is present
  */
 void ATDev_INA220::setCalibration_ATDev_32V_2A() {
+  startOperation();
+
   // By default we use a pretty huge range for the input voltage,
   // which probably isn't the most appropriate choice for system
   // that don't use a lot of power.  But all of the calculations
@@ -136,20 +799,14 @@ void ATDev_INA220::setCalibration_ATDev_32V_2A() {
   // Set multipliers to convert raw current/power values
   INA220_currentDivider_mA = 3.125f; // Current LSB = 320uA per bit (1000/320 = 3.125)
   INA220_powerMultiplier_mW = 6.4f; // Power LSB = 1mW per bit (2/1)
+  INA220_currentLSB_nA = 320000;    // Current LSB = 320uA per bit
 
-  // Set Calibration register to 'Cal' calculated above
-  Adafruit_BusIO_Register calibration_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CALIBRATION, 2, MSBFIRST);
-  calibration_reg.write(INA220_calValue, 2);
-
-  // Set Config register to take into account the settings above
+  // Set Calibration and Config registers to take into account the
+  // settings above
   uint16_t config = INA220_CONFIG_BVOLTAGERANGE_32V |
-                    INA220_CONFIG_GAIN_1_40MV | INA220_CONFIG_BADCRES_12BIT |
-                    INA220_CONFIG_SADCRES_12BIT_1S_532US |
+                    INA220_CONFIG_GAIN_1_40MV | adcSettings() |
                     INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
-  Adafruit_BusIO_Register config_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CONFIG, 2, MSBFIRST);
-  _success = config_reg.write(config, 2);
+  applyCalibration(config);
 }
 
 /*!
@@ -160,6 +817,360 @@ void ATDev_INA220::init() {
   setCalibration_ATDev_32V_2A();
 }
 
+/*!
+ *  @brief  Starts a new public operation: clears the status so getStatus()
+ *          reports the first failure of this operation only
+ */
+void ATDev_INA220::startOperation() { _status = INA220_STATUS_OK; }
+
+/*!
+ *  @brief  Records the latest transfer error as the operation's status,
+ *          unless an earlier failure is already recorded
+ */
+void ATDev_INA220::operationFailed() {
+  if (_status == INA220_STATUS_OK) {
+    _status = _lastError;
+  }
+}
+
+/*!
+ *  @brief  Sets the chip's register pointer without transferring data
+ *  @param  reg the register address
+ *  @param  stop false to keep the bus for a read after a repeated start
+ *  @return true: success false: the bus operation failed
+ */
+bool ATDev_INA220::writePointer(uint8_t reg, bool stop) {
+  // address + pointer
+  _busStats.transactions += 1;
+  _busStats.bytes += 2;
+
+  bool ok = i2c_dev && i2c_dev->write(&reg, 1, stop);
+  if (!ok) {
+    _busStats.nacks++;
+    _lastError = INA220_STATUS_NACK;
+  }
+
+  _lastPointer = ok ? reg : INA220_POINTER_UNKNOWN;
+  return ok;
+}
+
+/*!
+ *  @brief  Reads the register the chip's pointer is set to
+ *  @param  value set to the register contents
+ *  @return true: success false: the bus operation failed
+ */
+bool ATDev_INA220::readData(uint16_t *value) {
+  uint8_t buffer[2];
+
+  // address + 2 data bytes
+  _busStats.transactions += 1;
+  _busStats.bytes += 3;
+
+  bool ok = i2c_dev->read(buffer, 2);
+  if (ok) {
+    *value = ((uint16_t)buffer[0] << 8) | buffer[1];
+  } else {
+    _busStats.shortReads++;
+    _lastError = INA220_STATUS_SHORT_READ;
+    _lastPointer = INA220_POINTER_UNKNOWN;
+  }
+  return ok;
+}
+
+/*!
+ *  @brief  Reads a 16-bit register once, without retries
+ *  @param  reg the register address
+ *  @param  value set to the register contents
+ *  @return true: success false: the bus operation failed
+ */
+bool ATDev_INA220::readRegisterOnce(uint8_t reg, uint16_t *value) {
+  bool streamed = _streamingReads && reg == _lastPointer;
+
+  // Unless the chip still points at reg, write the pointer first and read
+  // after a repeated start. Transferred directly rather than through a
+  // temporary Adafruit_BusIO_Register, which costs a constructor call and
+  // generic width/byte order handling on every access.
+  if (!streamed && !writePointer(reg, false)) {
+    return false;
+  }
+  if (!readData(value)) {
+    return false;
+  }
+  if (streamed && streamSuspect(reg, *value) &&
+      !(writePointer(reg, false) && readData(value))) {
+    return false;
+  }
+  if (reg == INA220_REG_BUSVOLTAGE) {
+    noteBusVoltage(*value);
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Checks a read made without a pointer write. A chip reset moves
+ *          the pointer back to the config register without the driver
+ *          noticing, so a read that returns the config word, as set by the
+ *          driver or after power-on, may not come from reg at all.
+ *  @param  reg the register the read was meant for
+ *  @param  value the value read
+ *  @return true: read reg again after writing the pointer
+ */
+bool ATDev_INA220::streamSuspect(uint8_t reg, uint16_t value) {
+  return reg != INA220_REG_CONFIG &&
+         (value == INA220_config || value == INA220_CONFIG_POWERON);
+}
+
+/*!
+ *  @brief  Notes a bus voltage reading. CNVR means a conversion with the
+ *          current config completed, so the results now have its gain.
+ *  @param  bus the bus voltage register value
+ */
+void ATDev_INA220::noteBusVoltage(uint16_t bus) {
+  if (bus & INA220_BUSVOLTAGE_CNVR) {
+    _dataRange =
+        (INA220_config & INA220_CONFIG_GAIN_MASK) >> INA220_CONFIG_GAIN_SHIFT;
+    _rangePending = false;
+  }
+}
+
+/*!
+ *  @brief  Writes a 16-bit register once, without retries
+ *  @param  reg the register address
+ *  @param  value the value to write
+ *  @return true: success false: the bus operation failed
+ */
+bool ATDev_INA220::writeRegisterOnce(uint8_t reg, uint16_t value) {
+  uint8_t buffer[3] = {reg, (uint8_t)(value >> 8), (uint8_t)value};
+
+  // address + pointer + 2 data bytes
+  _busStats.transactions += 1;
+  _busStats.bytes += 4;
+
+  // Before begin() there is no device: the write fails, and settings
+  // only go to the shadow registers for begin() to apply
+  bool ok = i2c_dev && i2c_dev->write(buffer, 3);
+  if (!ok) {
+    _busStats.nacks++;
+    _lastError = INA220_STATUS_NACK;
+  } else if (reg == INA220_REG_CONFIG) {
+    noteConfigWrite(value);
+  }
+
+  _lastPointer = ok ? reg : INA220_POINTER_UNKNOWN;
+  return ok;
+}
+
+/*!
+ *  @brief  Reads a 16-bit register, retrying failed attempts as set by
+ *          setRetries(). All register reads of the driver go through here.
+ *  @param  reg the register address
+ *  @param  value set to the register contents
+ *  @return true: success false: the bus operation failed
+ */
+bool ATDev_INA220::readRegister(uint8_t reg, uint16_t *value) {
+  for (uint8_t attempt = 0; !readRegisterOnce(reg, value); attempt++) {
+    if (attempt >= _retries) {
+      operationFailed();
+      return false;
+    }
+    _busStats.retries[reg]++;
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Writes a 16-bit register, retrying failed attempts as set by
+ *          setRetries(). All register writes of the driver go through
+ *          here.
+ *  @param  reg the register address
+ *  @param  value the value to write
+ *  @return true: success false: the bus operation failed
+ */
+bool ATDev_INA220::writeRegister(uint8_t reg, uint16_t value) {
+  for (uint8_t attempt = 0; !writeRegisterOnce(reg, value); attempt++) {
+    if (attempt >= _retries) {
+      operationFailed();
+      return false;
+    }
+    _busStats.retries[reg]++;
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Writes the calibration value and the given config word to the
+ *          chip and restarts calibration tracking from a known state
+ *  @param  config the config register value to write
+ */
+void ATDev_INA220::applyCalibration(uint16_t config) {
+  INA220_config = config;
+  _calLastReadZero = false;
+  _calReadsSinceVerify = 0;
+
+  writeRegister(INA220_REG_CALIBRATION, INA220_calValue);
+  _success = writeRegister(INA220_REG_CONFIG, INA220_config);
+}
+
+/*!
+ *  @brief  Gets the ADC resolution and averaging bits of the config word,
+ *          so the setCalibration functions keep the chosen ADC settings
+ *  @return the BADC and SADC bits of the config register
+ */
+uint16_t ATDev_INA220::adcSettings() {
+  return INA220_config &
+         (INA220_CONFIG_BADCRES_MASK | INA220_CONFIG_SADCRES_MASK);
+}
+
+/*!
+ *  @brief  Makes sure the calibration register is valid before a
+ *          CURRENT or POWER read
+ */
+void ATDev_INA220::refreshCalibration() {
+  if (!_calTracking) {
+    // Sometimes a sharp load will reset the INA220, which will
+    // reset the cal register, meaning CURRENT and POWER will
+    // not be available ... avoid this by always setting a cal
+    // value even if it's an unfortunate extra step
+    writeRegister(INA220_REG_CALIBRATION, INA220_calValue);
+    return;
+  }
+
+  if (calibrationCheckDue()) {
+    checkCalibration();
+  }
+}
+
+/*!
+ *  @brief  Counts a CURRENT or POWER read towards the verify interval
+ *  @return true if the calibration register is due to be verified
+ */
+bool ATDev_INA220::calibrationCheckDue() {
+  return _calVerifyInterval && ++_calReadsSinceVerify >= _calVerifyInterval;
+}
+
+/*!
+ *  @brief  Checks whether a CURRENT or POWER reading hints at a chip reset
+ *  @param  value the raw CURRENT or POWER register value just read
+ *  @return true if the calibration register should be verified
+ */
+bool ATDev_INA220::calibrationSuspect(uint16_t value) {
+  if (!_calTracking) {
+    return false;
+  }
+
+  // A reset clears the cal register, after which CURRENT and POWER read
+  // as zero. Only check when a reading drops to zero so an idle load
+  // doesn't cost an extra transaction on every sample.
+  bool dropped = (value == 0) && !_calLastReadZero;
+  _calLastReadZero = (value == 0);
+  return dropped;
+}
+
+/*!
+ *  @brief  Checks whether a CURRENT or POWER reading hints at a chip reset
+ *          and restores the calibration if so
+ *  @param  value the raw CURRENT or POWER register value just read
+ *  @return true if the calibration had been lost and was restored, so the
+ *          reading should be repeated
+ */
+bool ATDev_INA220::calibrationLost(uint16_t value) {
+  return calibrationSuspect(value) && !checkCalibration();
+}
+
+/*!
+ *  @brief  Enables or disables calibration tracking. When enabled the
+ *          calibration register is written once by the setCalibration
+ *          functions instead of before every current/power read, and is
+ *          verified every verifyInterval reads or when a reading suggests
+ *          the chip was reset (e.g. by a brown-out).
+ *  @param  enable true to enable tracking, false to write the calibration
+ *          register before every current/power read
+ *  @param  verifyInterval number of current/power reads between checks of
+ *          the calibration register, 0 to only check after a suspected
+ *          reset
+ */
+void ATDev_INA220::setCalibrationTracking(bool enable,
+                                          uint16_t verifyInterval) {
+  _calTracking = enable;
+  _calVerifyInterval = verifyInterval;
+  _calReadsSinceVerify = 0;
+  _calLastReadZero = false;
+}
+
+/*!
+ *  @brief  Enables or disables streaming reads. The INA220 keeps its
+ *          register pointer between transactions, so when the same
+ *          register is read repeatedly (e.g. current-only sampling) the
+ *          pointer write can be skipped and only the 2 data bytes read.
+ *  @param  enable true to skip the pointer write when the pointer already
+ *          addresses the requested register
+ *  @note   A chip reset moves the pointer back to the config register
+ *          without the driver noticing. A read without the pointer write
+ *          that returns the config word is therefore read again with the
+ *          pointer, so the reset is found even with no verify interval.
+ */
+void ATDev_INA220::setStreamingReads(bool enable) {
+  _streamingReads = enable;
+  _lastPointer = INA220_POINTER_UNKNOWN;
+}
+
+/*!
+ *  @brief  Reads back the calibration register and, if it no longer holds
+ *          the expected value, rewrites the calibration and config
+ *          registers
+ *  @return true: calibration was intact false: calibration was restored
+ *          (or could not be read)
+ */
+bool ATDev_INA220::verifyCalibration() {
+  startOperation();
+  return checkCalibration();
+}
+
+/*!
+ *  @brief  Verifies the calibration register as part of the current
+ *          operation, see verifyCalibration()
+ *  @return true: calibration was intact false: calibration was restored
+ *          (or could not be read)
+ */
+bool ATDev_INA220::checkCalibration() {
+  uint16_t value;
+
+  _calReadsSinceVerify = 0;
+
+  _success = readRegister(INA220_REG_CALIBRATION, &value);
+  if (_success && value == INA220_calValue) {
+    return true;
+  }
+
+  applyCalibration(INA220_config);
+  return false;
+}
+
+/*!
+ *  @brief  Reads back the config and calibration registers and, if either
+ *          no longer matches the driver's copy (e.g. after a brown-out
+ *          reset), rewrites both
+ *  @return true: both registers were intact false: the registers were
+ *          restored (or could not be read)
+ */
+bool ATDev_INA220::verifyRegisters() {
+  uint16_t config, cal;
+
+  startOperation();
+  _calReadsSinceVerify = 0;
+
+  _success = readRegister(INA220_REG_CONFIG, &config) &&
+             readRegister(INA220_REG_CALIBRATION, &cal);
+  // The reset bit always reads back as 0
+  if (_success && config == (INA220_config & ~INA220_CONFIG_RESET) &&
+      cal == INA220_calValue) {
+    return true;
+  }
+
+  applyCalibration(INA220_config);
+  return false;
+}
+
 /*!
  *  @brief  Gets the raw bus voltage (16-bit signed integer, so +-32767)
  *  @return the raw bus voltage reading
@@ -167,9 +1178,11 @@ void ATDev_INA220::init() {
 int16_t ATDev_INA220::getBusVoltage_raw() {
   uint16_t value;
 
-  Adafruit_BusIO_Register bus_voltage_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_BUSVOLTAGE, 2, MSBFIRST);
-  _success = bus_voltage_reg.read(&value);
+  startOperation();
+  _success = readRegister(INA220_REG_BUSVOLTAGE, &value);
+  if (_success) {
+    noteFlags(INA220_SAMPLE_CNVR | INA220_SAMPLE_OVF, busFlags(value));
+  }
 
   // Shift to the right 3 to drop CNVR and OVF and multiply by LSB
   return (int16_t)((value >> 3) * 4);
@@ -181,9 +1194,12 @@ int16_t ATDev_INA220::getBusVoltage_raw() {
  */
 int16_t ATDev_INA220::getShuntVoltage_raw() {
   uint16_t value;
-  Adafruit_BusIO_Register shunt_voltage_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_SHUNTVOLTAGE, 2, MSBFIRST);
-  _success = shunt_voltage_reg.read(&value);
+
+  startOperation();
+  _success = readRegister(INA220_REG_SHUNTVOLTAGE, &value);
+  if (_success) {
+    noteFlags(INA220_SAMPLE_SHUNT_SAT, saturationFlags(value, 0, 0));
+  }
   return value;
 }
 
@@ -194,40 +1210,38 @@ int16_t ATDev_INA220::getShuntVoltage_raw() {
 int16_t ATDev_INA220::getCurrent_raw() {
   uint16_t value;
 
-  // Sometimes a sharp load will reset the INA220, which will
-  // reset the cal register, meaning CURRENT and POWER will
-  // not be available ... avoid this by always setting a cal
-  // value even if it's an unfortunate extra step
-  Adafruit_BusIO_Register calibration_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CALIBRATION, 2, MSBFIRST);
-  calibration_reg.write(INA220_calValue, 2);
+  startOperation();
+  refreshCalibration();
 
   // Now we can safely read the CURRENT register!
-  Adafruit_BusIO_Register current_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CURRENT, 2, MSBFIRST);
-  _success = current_reg.read(&value);
+  _success = readRegister(INA220_REG_CURRENT, &value);
+  if (_success && calibrationLost(value)) {
+    _success = readRegister(INA220_REG_CURRENT, &value);
+  }
+  if (_success) {
+    noteFlags(INA220_SAMPLE_CURRENT_SAT, saturationFlags(0, value, 0));
+  }
   return value;
 }
 
 /*!
- *  @brief  Gets the raw power value (16-bit signed integer, so +-32767)
+ *  @brief  Gets the raw power value (16-bit unsigned integer, 0..65535)
  *  @return raw power reading
  */
-int16_t ATDev_INA220::getPower_raw() {
+uint16_t ATDev_INA220::getPower_raw() {
   uint16_t value;
 
-  // Sometimes a sharp load will reset the INA220, which will
-  // reset the cal register, meaning CURRENT and POWER will
-  // not be available ... avoid this by always setting a cal
-  // value even if it's an unfortunate extra step
-  Adafruit_BusIO_Register calibration_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CALIBRATION, 2, MSBFIRST);
-  calibration_reg.write(INA220_calValue, 2);
+  startOperation();
+  refreshCalibration();
 
   // Now we can safely read the POWER register!
-  Adafruit_BusIO_Register power_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_POWER, 2, MSBFIRST);
-  _success = power_reg.read(&value);
+  _success = readRegister(INA220_REG_POWER, &value);
+  if (_success && calibrationLost(value)) {
+    _success = readRegister(INA220_REG_POWER, &value);
+  }
+  if (_success) {
+    noteFlags(INA220_SAMPLE_POWER_SAT, saturationFlags(0, 0, value));
+  }
   return value;
 }
 
@@ -272,6 +1286,71 @@ float ATDev_INA220::getPower_mW() {
   return valueDec;
 }
 
+/*!
+ *  @brief  Multiplies a raw reading by an LSB given in nano-units and
+ *          returns micro-units using only 32-bit integer math. The LSB is
+ *          split into whole micro-units and a remainder so neither product
+ *          overflows; the result is exact when the LSB is a whole number
+ *          of micro-units.
+ *  @param  raw the raw register value
+ *  @param  lsb_n the register LSB in nano-units (nA or nW)
+ *  @return the reading in micro-units (uA or uW)
+ */
+static int32_t scaleToMicro(int32_t raw, uint32_t lsb_n) {
+  return raw * (int32_t)(lsb_n / 1000) + raw * (int32_t)(lsb_n % 1000) / 1000;
+}
+
+/*!
+ *  @brief  Gets the shunt voltage in uV without floating point math
+ *  @return the shunt voltage converted to microvolts
+ */
+int32_t ATDev_INA220::getShuntVoltage_uV() {
+  return (int32_t)getShuntVoltage_raw() * 10;
+}
+
+/*!
+ *  @brief  Gets the bus voltage in mV without floating point math
+ *  @return the bus voltage converted to millivolts
+ */
+int32_t ATDev_INA220::getBusVoltage_mV() { return getBusVoltage_raw(); }
+
+/*!
+ *  @brief  Gets the current value in uA without floating point math
+ *  @return the current reading converted to microamps
+ */
+int32_t ATDev_INA220::getCurrent_uA() {
+  return scaleToMicro(getCurrent_raw(), INA220_currentLSB_nA);
+}
+
+/*!
+ *  @brief  Gets the power value in uW without floating point math
+ *  @return the power reading converted to microwatts
+ *  @note   The power register is unsigned, so this reports the full
+ *          0..65535 LSB range (up to about 2147W before int32 overflow).
+ */
+int32_t ATDev_INA220::getPower_uW() {
+  return scaleToMicro(getPower_raw(), 20 * INA220_currentLSB_nA);
+}
+
+/*!
+ *  @brief  Gets the current LSB of the active calibration
+ *  @return the current represented by one bit of the current register, in
+ *          nA. The power LSB is 20 times this.
+ */
+uint32_t ATDev_INA220::getCurrentLSB_nA() { return INA220_currentLSB_nA; }
+
+/*!
+ *  @brief  Gets the value the calibration register was set to
+ *  @return the calibration register value
+ */
+uint16_t ATDev_INA220::getCalibrationValue() { return INA220_calValue; }
+
+/*!
+ *  @brief  Gets the value the config register was set to
+ *  @return the config register value
+ */
+uint16_t ATDev_INA220::getConfig() { return INA220_config; }
+
 /*!
  *  @brief  Configures to INA220 to be able to measure up to 32V and 2A
  *          of current.  Each unit of current corresponds to 100uA, and
@@ -280,6 +1359,8 @@ float ATDev_INA220::getPower_mW() {
  *  @note   These calculations assume a 0.1 ohm resistor is present
  */
 void ATDev_INA220::setCalibration_32V_2A() {
+  startOperation();
+
   // By default we use a pretty huge range for the input voltage,
   // which probably isn't the most appropriate choice for system
   // that don't use a lot of power.  But all of the calculations
@@ -346,20 +1427,14 @@ void ATDev_INA220::setCalibration_32V_2A() {
   // Set multipliers to convert raw current/power values
   INA220_currentDivider_mA = 10; // Current LSB = 100uA per bit (1000/100 = 10)
   INA220_powerMultiplier_mW = 2; // Power LSB = 1mW per bit (2/1)
+  INA220_currentLSB_nA = 100000; // Current LSB = 100uA per bit
 
-  // Set Calibration register to 'Cal' calculated above
-  Adafruit_BusIO_Register calibration_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CALIBRATION, 2, MSBFIRST);
-  calibration_reg.write(INA220_calValue, 2);
-
-  // Set Config register to take into account the settings above
+  // Set Calibration and Config registers to take into account the
+  // settings above
   uint16_t config = INA220_CONFIG_BVOLTAGERANGE_32V |
-                    INA220_CONFIG_GAIN_8_320MV | INA220_CONFIG_BADCRES_12BIT |
-                    INA220_CONFIG_SADCRES_12BIT_1S_532US |
+                    INA220_CONFIG_GAIN_8_320MV | adcSettings() |
                     INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
-  Adafruit_BusIO_Register config_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CONFIG, 2, MSBFIRST);
-  _success = config_reg.write(config, 2);
+  applyCalibration(config);
 }
 
 /*!
@@ -368,16 +1443,16 @@ void ATDev_INA220::setCalibration_32V_2A() {
  *          boolean value
  */
 void ATDev_INA220::powerSave(bool on) {
-  Adafruit_BusIO_Register config_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CONFIG, 2, MSBFIRST);
+  startOperation();
 
-  Adafruit_BusIO_RegisterBits mode_bits =
-      Adafruit_BusIO_RegisterBits(&config_reg, 3, 0);
+  // The config word is shadowed, so no read-modify-write is needed
+  INA220_config &= ~INA220_CONFIG_MODE_MASK;
   if (on) {
-    _success = mode_bits.write(INA220_CONFIG_MODE_POWERDOWN);
+    INA220_config |= INA220_CONFIG_MODE_POWERDOWN;
   } else {
-    _success = mode_bits.write(INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS);
+    INA220_config |= INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
   }
+  _success = writeRegister(INA220_REG_CONFIG, INA220_config);
 }
 
 /*!
@@ -388,6 +1463,8 @@ void ATDev_INA220::powerSave(bool on) {
  *  @note   These calculations assume a 0.1 ohm resistor is present
  */
 void ATDev_INA220::setCalibration_32V_1A() {
+  startOperation();
+
   // By default we use a pretty huge range for the input voltage,
   // which probably isn't the most appropriate choice for system
   // that don't use a lot of power.  But all of the calculations
@@ -457,20 +1534,14 @@ void ATDev_INA220::setCalibration_32V_1A() {
   // Set multipliers to convert raw current/power values
   INA220_currentDivider_mA = 25;    // Current LSB = 40uA per bit (1000/40 = 25)
   INA220_powerMultiplier_mW = 0.8f; // Power LSB = 800uW per bit
+  INA220_currentLSB_nA = 40000;     // Current LSB = 40uA per bit
 
-  // Set Calibration register to 'Cal' calculated above
-  Adafruit_BusIO_Register calibration_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CALIBRATION, 2, MSBFIRST);
-  calibration_reg.write(INA220_calValue, 2);
-
-  // Set Config register to take into account the settings above
+  // Set Calibration and Config registers to take into account the
+  // settings above
   uint16_t config = INA220_CONFIG_BVOLTAGERANGE_32V |
-                    INA220_CONFIG_GAIN_8_320MV | INA220_CONFIG_BADCRES_12BIT |
-                    INA220_CONFIG_SADCRES_12BIT_1S_532US |
+                    INA220_CONFIG_GAIN_8_320MV | adcSettings() |
                     INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
-  Adafruit_BusIO_Register config_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CONFIG, 2, MSBFIRST);
-  _success = config_reg.write(config, 2);
+  applyCalibration(config);
 }
 
 /*!
@@ -479,6 +1550,7 @@ void ATDev_INA220::setCalibration_32V_1A() {
  *     only supporting 16V at 400mA max.
  */
 void ATDev_INA220::setCalibration_16V_400mA() {
+  startOperation();
 
   // Calibration which uses the highest precision for
   // current measurement (0.1mA), at the expense of
@@ -549,20 +1621,95 @@ void ATDev_INA220::setCalibration_16V_400mA() {
   // Set multipliers to convert raw current/power values
   INA220_currentDivider_mA = 20;    // Current LSB = 50uA per bit (1000/50 = 20)
   INA220_powerMultiplier_mW = 1.0f; // Power LSB = 1mW per bit
+  INA220_currentLSB_nA = 50000;     // Current LSB = 50uA per bit
 
-  // Set Calibration register to 'Cal' calculated above
-  Adafruit_BusIO_Register calibration_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CALIBRATION, 2, MSBFIRST);
-  calibration_reg.write(INA220_calValue, 2);
-  // Set Config register to take into account the settings above
+  // Set Calibration and Config registers to take into account the
+  // settings above
   uint16_t config = INA220_CONFIG_BVOLTAGERANGE_16V |
-                    INA220_CONFIG_GAIN_1_40MV | INA220_CONFIG_BADCRES_12BIT |
-                    INA220_CONFIG_SADCRES_12BIT_1S_532US |
+                    INA220_CONFIG_GAIN_1_40MV | adcSettings() |
                     INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
+  applyCalibration(config);
+}
+
+/*!
+ *  @brief  Calibrates for an arbitrary shunt resistor and maximum current.
+ *          Picks the smallest PGA range that fits the maximum shunt
+ *          voltage and the smallest 1, 2 or 5 step current LSB that
+ *          still fits the maximum current in the current register.
+ *  @param  shunt_ohms the shunt resistor value in ohms
+ *  @param  max_expected_A the largest current to be measured, in amps.
+ *          Limited to what the 320mV range can measure across the shunt.
+ *  @param  range the bus voltage range
+ *  @return the resulting current LSB (resolution) in amps, 0 if the
+ *          parameters can't be calibrated
+ */
+float ATDev_INA220::setCalibration(float shunt_ohms, float max_expected_A,
+                                   INA220_BusVoltageRange range) {
+  static const uint16_t gains[] = {
+      INA220_CONFIG_GAIN_1_40MV, INA220_CONFIG_GAIN_2_80MV,
+      INA220_CONFIG_GAIN_4_160MV, INA220_CONFIG_GAIN_8_320MV};
+
+  startOperation();
+  if (!(shunt_ohms > 0) || !(max_expected_A > 0)) {
+    return 0;
+  }
+
+  // 1. Choose the smallest PGA range that fits VSHUNT_MAX, clamping the
+  //    current to what the 320mV range can measure
+  //    (with half a microvolt of slack so e.g. 2mOhm * 40A fits 80mV)
+  float vshunt_max_uV = max_expected_A * shunt_ohms * 1000000;
+  uint8_t gain = 0;
+  while (gain < 3 && vshunt_max_uV > 40000.0f * (1 << gain) + 0.5f) {
+    gain++;
+  }
+  if (vshunt_max_uV > 320000.5f) {
+    max_expected_A = 0.32f / shunt_ohms;
+  }
 
-  Adafruit_BusIO_Register config_reg =
-      Adafruit_BusIO_Register(i2c_dev, INA220_REG_CONFIG, 2, MSBFIRST);
-  _success = config_reg.write(config, 2);
+  // 2. MinimumLSB = MaxExpected_I / 32767 keeps the current register
+  //    from overflowing at the maximum current. Round it up to a 1, 2 or
+  //    5 step as the datasheet suggests, so e.g. 0.1 Ohm / 2A gives the
+  //    100uA LSB of setCalibration_32V_2A()
+  static const uint8_t steps[] = {1, 2, 5};
+  float minimum_lsb = max_expected_A / 32767;
+  float decade = 1e-9f;
+  uint8_t step = 0;
+  while (decade * steps[step] < minimum_lsb) {
+    if (++step == 3) {
+      step = 0;
+      decade *= 10;
+    }
+  }
+  float current_lsb = decade * steps[step];
+
+  // 3. Cal = trunc (0.04096 / (Current_LSB * RSHUNT)), bit 0 is always
+  //    zero. The rounded LSB gives a whole Cal, so round to nearest to
+  //    keep float error from dropping it by one.
+  float cal = 0.04096f / (current_lsb * shunt_ohms);
+  if (cal > 65534) {
+    cal = 65534;
+  }
+  uint16_t calValue = (uint16_t)(cal + 0.5f) & 0xFFFE;
+  if (calValue == 0) {
+    return 0;
+  }
+  INA220_calValue = calValue;
+
+  // 4. Recompute the LSB the truncated Cal actually gives, and the power
+  //    LSB (PowerLSB = 20 * CurrentLSB)
+  current_lsb = 0.04096f / (calValue * shunt_ohms);
+
+  // Set multipliers to convert raw current/power values
+  INA220_currentDivider_mA = 1 / (current_lsb * 1000);
+  INA220_powerMultiplier_mW = 20 * current_lsb * 1000;
+  INA220_currentLSB_nA = (uint32_t)(current_lsb * 1000000000 + 0.5f);
+
+  // Set Calibration and Config registers to take into account the
+  // settings above
+  uint16_t config = range | gains[gain] | adcSettings() |
+                    INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
+  applyCalibration(config);
+  return current_lsb;
 }
 
 /*!
@@ -571,6 +1718,73 @@ void ATDev_INA220::setCalibration_16V_400mA() {
  *  @return true: Last operation was successful false: Last operation failed
  *  @note   For function calls that have intermediary device operations,
  *          e.g. calibration before read/write, only the final operation's
- *          result is stored.
+ *          result is stored. getStatus() reports the first failure.
  */
 bool ATDev_INA220::success() { return _success; }
+
+/*!
+ *  @brief  Gets the result of the last operation called on the device,
+ *          including intermediary operations such as the calibration
+ *          write before a current read
+ *  @return INA220_STATUS_OK, or the first failure of the operation
+ *  @note   For startRead()/poll() the operation spans every poll() of the
+ *          read, and each poll() reports it again even after other calls
+ *          were made in between.
+ */
+INA220_Status ATDev_INA220::getStatus() { return _status; }
+
+/*!
+ *  @brief  Sets how often a failed register access is repeated before
+ *          the operation gives up. Retries are counted per register in
+ *          the bus statistics. Steps of poll() aren't retried.
+ *  @param  retries the number of extra attempts, 0 to disable retries
+ */
+void ATDev_INA220::setRetries(uint8_t retries) { _retries = retries; }
+
+/*!
+ *  @brief  Gets the I2C traffic and errors of the driver since
+ *          construction or the last resetBusStats() call
+ *  @return the transaction, byte, error and retry counters
+ */
+const ATDev_INA220::BusStats &ATDev_INA220::getBusStats() { return _busStats; }
+
+/*!
+ *  @brief  Clears the I2C traffic, error and retry counters
+ */
+void ATDev_INA220::resetBusStats() {
+  _busStats.transactions = 0;
+  _busStats.bytes = 0;
+  _busStats.nacks = 0;
+  _busStats.shortReads = 0;
+  for (uint8_t i = 0; i < INA220_REG_COUNT; i++) {
+    _busStats.retries[i] = 0;
+  }
+}
+
+/*!
+ *  @brief  Gets the flags of the latest reading of each register, so
+ *          callers of the single-register getters can tell a clipped
+ *          reading from a valid one
+ *  @return INA220_SAMPLE_* flags: CNVR/OVF from the latest bus voltage
+ *          read and each *_SAT flag from the latest read of its register
+ */
+uint8_t ATDev_INA220::getFlags() { return _flags; }
+
+/*!
+ *  @brief  Gets the number of overflowed and saturated readings since
+ *          construction or the last resetClipStats() call
+ *  @return the counters
+ */
+const ATDev_INA220::ClipStats &ATDev_INA220::getClipStats() {
+  return _clipStats;
+}
+
+/*!
+ *  @brief  Clears the overflow and saturation counters
+ */
+void ATDev_INA220::resetClipStats() {
+  _clipStats.overflows = 0;
+  _clipStats.shuntSaturations = 0;
+  _clipStats.currentSaturations = 0;
+  _clipStats.powerSaturations = 0;
+}
@@ -18,11 +18,18 @@
 #define _LIB_ATDev_INA220_
 
 #include "Arduino.h"
-#include <Adafruit_BusIO_Register.h>
 #include <Adafruit_I2CDevice.h>
 #include <Wire.h>
 
-/** calculated I2C address: 0 = GND, 1 = V+ **/
+/** address pin connections for INA220_CALC_ADDRESS **/
+enum {
+  INA220_ADDR_GND = 0, // pin tied to GND
+  INA220_ADDR_VS = 1,  // pin tied to V+
+  INA220_ADDR_SDA = 2, // pin tied to SDA
+  INA220_ADDR_SCL = 3, // pin tied to SCL
+};
+
+/** calculated I2C address: 0 = GND, 1 = V+, 2 = SDA, 3 = SCL **/
 /* The address is controlled by the A0 and A1 inputs on the INA220:
  *
  * Calculated address: b100ABCD
@@ -31,11 +38,12 @@
  *
  * E.g. if A0 is tied to ground and A1 is tied to V+,
  * the resulting address is b1000100 = 0x44
- *
- * SDA and SCL options aren't implemented.
  */
 #define INA220_CALC_ADDRESS(INA_ADDR0, INA_ADDR1)                              \
-  (0x40 | (INA_ADDR0 != 0 ? 0x01 : 0x00) | (INA_ADDR1 != 0 ? 0x04 : 0x00))
+  (0x40 | ((INA_ADDR0)&0x03) | (((INA_ADDR1)&0x03) << 2))
+
+/** number of distinct addresses the A0/A1 pins can select **/
+#define INA220_ADDRESS_COUNT (16)
 
 /** default I2C address **/
 #define INA220_ADDRESS (0x41) // 1000001 (A0=V A1=GND)
@@ -43,6 +51,12 @@
 /** read **/
 #define INA220_READ (0x01)
 
+/** number of registers, 0x00 to 0x05 **/
+#define INA220_REG_COUNT (6)
+
+/** register pointer value meaning the chip's pointer is not known **/
+#define INA220_POINTER_UNKNOWN (0xFF)
+
 /*=========================================================================
     CONFIG REGISTER (R/W)
 **************************************************************************/
@@ -53,31 +67,40 @@
 /** reset bit **/
 #define INA220_CONFIG_RESET (0x8000) // Reset Bit
 
+/** config register value after power-on or reset **/
+#define INA220_CONFIG_POWERON (0x399F)
+
 /** mask for bus voltage range **/
 #define INA220_CONFIG_BVOLTAGERANGE_MASK (0x2000) // Bus Voltage Range Mask
 
 /** bus voltage range values **/
-enum {
+typedef enum {
   INA220_CONFIG_BVOLTAGERANGE_16V = (0x0000), // 0-16V Range
   INA220_CONFIG_BVOLTAGERANGE_32V = (0x2000), // 0-32V Range
-};
+} INA220_BusVoltageRange;
 
 /** mask for gain bits **/
 #define INA220_CONFIG_GAIN_MASK (0x1800) // Gain Mask
 
 /** values for gain bits **/
-enum {
+typedef enum {
   INA220_CONFIG_GAIN_1_40MV = (0x0000),  // Gain 1, 40mV Range
   INA220_CONFIG_GAIN_2_80MV = (0x0800),  // Gain 2, 80mV Range
   INA220_CONFIG_GAIN_4_160MV = (0x1000), // Gain 4, 160mV Range
   INA220_CONFIG_GAIN_8_320MV = (0x1800), // Gain 8, 320mV Range
-};
+} INA220_ShuntGain;
+
+/** position of the gain bits, the gain index 0..3 selects 40mV << index **/
+#define INA220_CONFIG_GAIN_SHIFT (11)
+
+/** shunt voltage register reading at full scale of the 40mV range **/
+#define INA220_SHUNT_FULLSCALE_40MV (4000)
 
 /** mask for bus ADC resolution bits **/
 #define INA220_CONFIG_BADCRES_MASK (0x0780)
 
 /** values for bus ADC resolution **/
-enum {
+typedef enum {
   INA220_CONFIG_BADCRES_9BIT = (0x0000),  // 9-bit bus res = 0..511
   INA220_CONFIG_BADCRES_10BIT = (0x0080), // 10-bit bus res = 0..1023
   INA220_CONFIG_BADCRES_11BIT = (0x0100), // 11-bit bus res = 0..2047
@@ -97,14 +120,14 @@ enum {
   INA220_CONFIG_BADCRES_12BIT_128S_69MS =
       (0x0780), // 128 x 12-bit bus samples averaged together
 
-};
+} INA220_BusADCResolution;
 
 /** mask for shunt ADC resolution bits **/
 #define INA220_CONFIG_SADCRES_MASK                                             \
   (0x0078) // Shunt ADC Resolution and Averaging Mask
 
 /** values for shunt ADC resolution **/
-enum {
+typedef enum {
   INA220_CONFIG_SADCRES_9BIT_1S_84US = (0x0000),   // 1 x 9-bit shunt sample
   INA220_CONFIG_SADCRES_10BIT_1S_148US = (0x0008), // 1 x 10-bit shunt sample
   INA220_CONFIG_SADCRES_11BIT_1S_276US = (0x0010), // 1 x 11-bit shunt sample
@@ -123,7 +146,7 @@ enum {
       (0x0070), // 64 x 12-bit shunt samples averaged together
   INA220_CONFIG_SADCRES_12BIT_128S_69MS =
       (0x0078), // 128 x 12-bit shunt samples averaged together
-};
+} INA220_ShuntADCResolution;
 
 /** mask for operating mode bits **/
 #define INA220_CONFIG_MODE_MASK (0x0007) // Operating Mode Mask
@@ -148,6 +171,12 @@ enum {
 /** bus voltage register **/
 #define INA220_REG_BUSVOLTAGE (0x02)
 
+/** conversion ready bit in the bus voltage register **/
+#define INA220_BUSVOLTAGE_CNVR (0x0002)
+
+/** math overflow bit in the bus voltage register **/
+#define INA220_BUSVOLTAGE_OVF (0x0001)
+
 /** power register **/
 #define INA220_REG_POWER (0x03)
 
@@ -157,43 +186,228 @@ enum {
 /** calibration register **/
 #define INA220_REG_CALIBRATION (0x05)
 
+/** snapshot flag: a new conversion was ready when the snapshot was read **/
+#define INA220_SAMPLE_CNVR (0x01)
+
+/** snapshot flag: current or power calculation overflowed **/
+#define INA220_SAMPLE_OVF (0x02)
+
+/** snapshot flag: shunt voltage at the full scale of its range **/
+#define INA220_SAMPLE_SHUNT_SAT (0x04)
+
+/** snapshot flag: current register at its signed 16-bit limit **/
+#define INA220_SAMPLE_CURRENT_SAT (0x08)
+
+/** snapshot flag: power register at its unsigned 16-bit limit **/
+#define INA220_SAMPLE_POWER_SAT (0x10)
+
+/** snapshot flags marking a clipped or invalid reading **/
+#define INA220_SAMPLE_CLIPPED                                                  \
+  (INA220_SAMPLE_OVF | INA220_SAMPLE_SHUNT_SAT | INA220_SAMPLE_CURRENT_SAT |   \
+   INA220_SAMPLE_POWER_SAT)
+
+/** status of an asynchronous read, returned by ATDev_INA220::poll() **/
+typedef enum {
+  INA220_ASYNC_PENDING = 0, // read in progress, call poll() again
+  INA220_ASYNC_READY = 1,   // snapshot complete
+  INA220_ASYNC_ERROR = 2,   // bus operation failed or no read started
+} INA220_AsyncStatus;
+
+/** result of the last operation, returned by ATDev_INA220::getStatus() **/
+typedef enum {
+  INA220_STATUS_OK = 0,         // every bus operation succeeded
+  INA220_STATUS_NACK = 1,       // a write or the address was not acknowledged
+  INA220_STATUS_SHORT_READ = 2, // a read returned fewer bytes than requested
+} INA220_Status;
+
+template <uint8_t N> class ATDev_INA220_Array;
+
 /*!
  *   @brief  Class that stores state and functions for interacting with INA220
  *  current/power monitor IC
  */
 class ATDev_INA220 {
 public:
+  /*!
+   *  @brief  Shunt, bus, current and power read back to back from the same
+   *          conversion
+   */
+  struct Snapshot {
+    int16_t shuntVoltage_raw; /**< raw shunt voltage, 10uV per bit */
+    int16_t busVoltage_raw;   /**< bus voltage in mV, CNVR/OVF removed */
+    int16_t current_raw;      /**< raw current register */
+    uint16_t power_raw;       /**< raw power register, unsigned */
+    float shuntVoltage_mV;    /**< shunt voltage in mV */
+    float busVoltage_V;       /**< bus voltage in V */
+    float current_mA;         /**< current in mA */
+    float power_mW;           /**< power in mW */
+    uint8_t flags;            /**< INA220_SAMPLE_* flags */
+    uint8_t range;            /**< shunt range, 0..3 for 40mV..320mV */
+  };
+
+  /*!
+   *  @brief  Running totals of the I2C traffic generated by the driver
+   */
+  struct BusStats {
+    uint32_t transactions; /**< start conditions, repeated starts included */
+    uint32_t bytes;        /**< bytes on the wire, address bytes included */
+    uint32_t nacks;        /**< writes that were not acknowledged */
+    uint32_t shortReads;   /**< reads that returned too few bytes */
+    /** retried accesses per register, indexed by register address */
+    uint16_t retries[INA220_REG_COUNT];
+  };
+
+  /*!
+   *  @brief  Running totals of overflowed and saturated readings
+   */
+  struct ClipStats {
+    uint32_t overflows;          /**< readings with OVF set */
+    uint32_t shuntSaturations;   /**< shunt readings at full scale */
+    uint32_t currentSaturations; /**< current readings at the limit */
+    uint32_t powerSaturations;   /**< power readings at the limit */
+  };
+
   ATDev_INA220(uint8_t addr = INA220_ADDRESS);
-  ~ATDev_INA220();
+  virtual ~ATDev_INA220();
+  // Not copyable: i2c_dev points into the object's own _i2cStorage
+  ATDev_INA220(const ATDev_INA220 &) = delete;
+  ATDev_INA220 &operator=(const ATDev_INA220 &) = delete;
   bool begin(TwoWire *theWire = &Wire);
   void setCalibration_ATDev_32V_2A();
   void setCalibration_32V_2A();
   void setCalibration_32V_1A();
   void setCalibration_16V_400mA();
+  float setCalibration(float shunt_ohms, float max_expected_A,
+                       INA220_BusVoltageRange range =
+                           INA220_CONFIG_BVOLTAGERANGE_32V);
   float getBusVoltage_V();
   float getShuntVoltage_mV();
   float getCurrent_mA();
   float getPower_mW();
+  int32_t getShuntVoltage_uV();
+  int32_t getBusVoltage_mV();
+  int32_t getCurrent_uA();
+  int32_t getPower_uW();
+  uint32_t getCurrentLSB_nA();
+  uint16_t getCalibrationValue();
+  uint16_t getConfig();
+  bool readAll(Snapshot &snapshot);
+  bool pollSample(Snapshot &snapshot);
+  void startRead(bool onlyIfReady = false);
+  INA220_AsyncStatus poll(Snapshot &snapshot);
+  bool
+  triggerConversion(uint8_t mode = INA220_CONFIG_MODE_SANDBVOLT_TRIGGERED);
+  bool waitForConversion(uint32_t timeout_ms = 100);
+  void setBusADCResolution(INA220_BusADCResolution resolution);
+  void setShuntADCResolution(INA220_ShuntADCResolution resolution);
+  void setGain(INA220_ShuntGain gain);
+  void setAutoRange(bool enable);
+  uint32_t getConversionTime_us();
   void powerSave(bool on);
+  void setCalibrationTracking(bool enable, uint16_t verifyInterval = 64);
+  bool verifyCalibration();
+  bool verifyRegisters();
+  void setStreamingReads(bool enable);
   bool success();
+  INA220_Status getStatus();
+  void setRetries(uint8_t retries);
+  const BusStats &getBusStats();
+  void resetBusStats();
+  uint8_t getFlags();
+  const ClipStats &getClipStats();
+  void resetClipStats();
+
+protected:
+  template <uint8_t N> friend class ATDev_INA220_Array;
 
-private:
+  // The I2C device is constructed in place in _i2cStorage by begin(), so
+  // the driver never allocates from the heap
   Adafruit_I2CDevice *i2c_dev = NULL;
+  alignas(Adafruit_I2CDevice) uint8_t _i2cStorage[sizeof(Adafruit_I2CDevice)];
 
   bool _success;
+  // First failure of the current operation, and of the latest transfer
+  INA220_Status _status;
+  INA220_Status _lastError;
+  uint8_t _retries;
+  BusStats _busStats;
+  // INA220_SAMPLE_* flags of the latest reading of each register
+  uint8_t _flags;
+  ClipStats _clipStats;
 
   uint8_t INA220_i2caddr = -1;
   uint32_t INA220_calValue;
+  uint16_t INA220_config;
+  // Calibration tracking: when enabled the CALIBRATION register is only
+  // written by the setCalibration functions and re-checked periodically
+  // instead of before every CURRENT/POWER read
+  bool _calTracking;
+  bool _calLastReadZero;
+  uint16_t _calVerifyInterval;
+  uint16_t _calReadsSinceVerify;
+  // Streaming reads: skip the pointer write when the chip already points
+  // at the register being read
+  bool _streamingReads;
+  uint8_t _lastPointer;
+  // Auto-ranging: pick the shunt gain from each snapshot's shunt voltage
+  bool _autoRange;
+  // Shunt range of the results in the chip's registers. After a gain
+  // switch they keep the old range until the next conversion completes.
+  uint8_t _dataRange;
+  bool _rangePending;
+  uint32_t _rangeSwitch_us;
+  // Asynchronous read progress, see poll()
+  uint8_t _asyncState;
+  uint8_t _asyncResume;
+  bool _asyncOnlyIfReady;
+  bool _asyncPointerSent;
+  // First failure of the asynchronous read, kept apart from _status so
+  // blocking calls between the steps don't clear it
+  INA220_Status _asyncStatus;
   // The following multipliers are used to convert raw current and power
   // values to mA and mW, taking into account the current config settings
   float INA220_currentDivider_mA;
   float INA220_powerMultiplier_mW;
+  // Current LSB in nA for the integer API, the power LSB is 20 times this
+  uint32_t INA220_currentLSB_nA;
 
   void init();
+  bool beginDevice(TwoWire *theWire);
+  bool readSnapshot(Snapshot &snapshot, bool onlyIfReady);
+  void decodeBusVoltage(Snapshot &snapshot, uint16_t bus);
+  void scaleSnapshot(Snapshot &snapshot);
+  virtual void scaleCurrentPower(Snapshot &snapshot);
+  INA220_ShuntGain autoRangeGain(int16_t shunt);
+  uint8_t dataRange();
+  void noteConfigWrite(uint16_t config);
+  uint8_t saturationFlags(int16_t shunt, int16_t current, uint16_t power);
+  void noteFlags(uint8_t mask, uint8_t flags);
+  bool asyncRead(uint8_t reg, uint16_t *value);
+  bool asyncWrite(uint8_t reg, uint16_t value);
+  void asyncFailed();
+  void asyncEnter(uint8_t state);
+  void startOperation();
+  void operationFailed();
+  bool writePointer(uint8_t reg, bool stop = true);
+  bool readData(uint16_t *value);
+  bool streamSuspect(uint8_t reg, uint16_t value);
+  void noteBusVoltage(uint16_t bus);
+  bool readRegisterOnce(uint8_t reg, uint16_t *value);
+  bool writeRegisterOnce(uint8_t reg, uint16_t value);
+  bool readRegister(uint8_t reg, uint16_t *value);
+  bool writeRegister(uint8_t reg, uint16_t value);
+  uint16_t adcSettings();
+  void applyCalibration(uint16_t config);
+  void applyGain(INA220_ShuntGain gain);
+  bool checkCalibration();
+  void refreshCalibration();
+  bool calibrationCheckDue();
+  bool calibrationSuspect(uint16_t value);
+  bool calibrationLost(uint16_t value);
   int16_t getBusVoltage_raw();
   int16_t getShuntVoltage_raw();
   int16_t getCurrent_raw();
-  int16_t getPower_raw();
+  uint16_t getPower_raw();
 };
 
 #endif
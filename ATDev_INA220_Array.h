@@ -0,0 +1,151 @@
+/*!
+ * @file ATDev_INA220_Array.h
+ *
+ * Manager for several INA220s sharing one I2C bus.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _LIB_ATDev_INA220_ARRAY_
+#define _LIB_ATDev_INA220_ARRAY_
+
+#include "ATDev_INA220.h"
+
+/*!
+ *  @brief  Owns up to 16 INA220s on one TwoWire bus, configures them in one
+ *          pass and reads them round-robin. Each device keeps its own
+ *          calibration.
+ *  @tparam N the number of devices
+ */
+template <uint8_t N> class ATDev_INA220_Array {
+  static_assert(N > 0 && N <= INA220_ADDRESS_COUNT,
+                "an I2C bus can hold 1 to 16 INA220s");
+
+public:
+  /*!
+   *  @brief  Instantiates the devices at addresses 0x40 to 0x40 + N - 1
+   */
+  ATDev_INA220_Array() {
+    for (uint8_t i = 0; i < N; i++) {
+      _devices[i].INA220_i2caddr = INA220_CALC_ADDRESS(i & 0x03, i >> 2);
+    }
+    _present = 0;
+    _next = 0;
+  }
+
+  /*!
+   *  @brief  Sets up every device with the default calibration
+   *  @param theWire the TwoWire object shared by all devices
+   *  @param addresses N I2C addresses to use instead of 0x40 onwards, or
+   *         NULL
+   *  @return the number of devices found
+   */
+  uint8_t begin(TwoWire *theWire = &Wire, const uint8_t *addresses = NULL) {
+    uint8_t found = 0;
+
+    _present = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      if (addresses) {
+        _devices[i].INA220_i2caddr = addresses[i];
+      }
+      if (_devices[i].begin(theWire)) {
+        _present |= (uint16_t)1 << i;
+        found++;
+      }
+    }
+    return found;
+  }
+
+  /*!
+   *  @brief  Gets one device, e.g. to give it its own calibration
+   *  @param i the device index
+   *  @return the device
+   */
+  ATDev_INA220 &operator[](uint8_t i) { return _devices[i]; }
+
+  /*!
+   *  @brief  Gets the number of devices managed
+   *  @return N
+   */
+  uint8_t size() { return N; }
+
+  /*!
+   *  @brief  Checks whether a device answered in begin()
+   *  @param i the device index
+   *  @return true if the device was found
+   */
+  bool present(uint8_t i) { return (_present >> i) & 1; }
+
+  /*!
+   *  @brief  Calibrates every device found for the same shunt and range,
+   *          see ATDev_INA220::setCalibration()
+   *  @param  shunt_ohms the shunt resistor value in ohms
+   *  @param  max_expected_A the largest current to be measured, in amps
+   *  @param  range the bus voltage range
+   */
+  void setCalibration(float shunt_ohms, float max_expected_A,
+                      INA220_BusVoltageRange range =
+                          INA220_CONFIG_BVOLTAGERANGE_32V) {
+    for (uint8_t i = 0; i < N; i++) {
+      if (present(i)) {
+        _devices[i].setCalibration(shunt_ohms, max_expected_A, range);
+      }
+    }
+  }
+
+  /*!
+   *  @brief  Enables calibration tracking and streaming reads on every
+   *          device found, the cheapest settings for scanning a bus
+   *  @param  verifyInterval number of current/power reads between
+   *          calibration checks, see ATDev_INA220::setCalibrationTracking()
+   */
+  void setFastReads(uint16_t verifyInterval = 64) {
+    for (uint8_t i = 0; i < N; i++) {
+      if (present(i)) {
+        _devices[i].setCalibrationTracking(true, verifyInterval);
+        _devices[i].setStreamingReads(true);
+      }
+    }
+  }
+
+  /*!
+   *  @brief  Reads the next device found, in round-robin order
+   *  @param  snapshot filled with the device's readings
+   *  @return the index of the device read, -1 if no device was found or
+   *          the read failed
+   */
+  int8_t readNext(ATDev_INA220::Snapshot &snapshot) {
+    for (uint8_t tries = 0; tries < N; tries++) {
+      uint8_t i = _next;
+      _next = (_next + 1) % N;
+      if (present(i)) {
+        return _devices[i].readAll(snapshot) ? i : -1;
+      }
+    }
+    return -1;
+  }
+
+  /*!
+   *  @brief  Reads every device found in one pass
+   *  @param  snapshots N snapshots, entry i is filled for device i
+   *  @return the number of devices read successfully
+   */
+  uint8_t readAll(ATDev_INA220::Snapshot *snapshots) {
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < N; i++) {
+      if (present(i) && _devices[i].readAll(snapshots[i])) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+private:
+  ATDev_INA220 _devices[N];
+  uint16_t _present;
+  uint8_t _next;
+};
+
+#endif
@@ -0,0 +1,255 @@
+/*!
+ * @file ATDev_INA220_Buffer.h
+ *
+ * Sample records, packing and a lock-free ring buffer for handing INA220
+ * readings from an interrupt or task to the main loop.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _LIB_ATDev_INA220_BUFFER_
+#define _LIB_ATDev_INA220_BUFFER_
+
+#include "ATDev_INA220.h"
+
+/** orders buffer memory accesses between producer and consumer **/
+#if defined(__AVR__)
+// single core: keeping the compiler from reordering is enough
+#define INA220_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define INA220_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+/*!
+ *  @brief  Raw readings of one conversion plus the time they were taken
+ */
+struct ATDev_INA220_Sample {
+  uint32_t timestamp_us;    /**< micros() when the sample was read */
+  int16_t shuntVoltage_raw; /**< raw shunt voltage, 10uV per bit */
+  int16_t busVoltage_raw;   /**< bus voltage in mV */
+  int16_t current_raw;      /**< raw current register */
+  uint8_t flags;            /**< INA220_SAMPLE_* flags */
+
+  /*!
+   *  @brief  Fills the record from a snapshot
+   *  @param  snapshot the readings
+   *  @param  timestamp micros() when the snapshot was read
+   */
+  void set(const ATDev_INA220::Snapshot &snapshot, uint32_t timestamp) {
+    timestamp_us = timestamp;
+    shuntVoltage_raw = snapshot.shuntVoltage_raw;
+    busVoltage_raw = snapshot.busVoltage_raw;
+    current_raw = snapshot.current_raw;
+    flags = snapshot.flags;
+  }
+};
+
+/** packed sample time unit in us, the resolution of micros() on AVR **/
+#define INA220_PACKED_TICK_US (4)
+
+/** packed sample flag in bit 2 of the bus register word: the time since the
+ *  previous sample didn't fit and was clamped **/
+#define INA220_PACKED_GAP (0x0004)
+
+/*!
+ *  @brief  8-byte raw sample: the register words of one conversion and the
+ *          time since the previous sample. Power isn't stored, the decoder
+ *          recomputes it from current and bus voltage like the chip does.
+ */
+struct ATDev_INA220_PackedSample {
+  uint16_t delta_ticks;     /**< time since the previous sample, 4us units */
+  int16_t shuntVoltage_raw; /**< raw shunt voltage register */
+  uint16_t busVoltage_reg;  /**< bus voltage register incl. CNVR/OVF bits */
+  int16_t current_raw;      /**< raw current register */
+};
+
+/*!
+ *  @brief  Packs snapshots into ATDev_INA220_PackedSample records. Integer
+ *          only, so it can run in the sampling interrupt or task.
+ */
+class ATDev_INA220_SamplePacker {
+public:
+  /*!
+   *  @brief  Instantiates a packer
+   *  @param  start_us micros() the first delta is measured from; hand the
+   *          same value to the decoder
+   */
+  ATDev_INA220_SamplePacker(uint32_t start_us = 0) { _last_us = start_us; }
+
+  /*!
+   *  @brief  Packs one snapshot
+   *  @param  snapshot the readings
+   *  @param  timestamp_us micros() when the snapshot was read
+   *  @return the packed record
+   */
+  ATDev_INA220_PackedSample pack(const ATDev_INA220::Snapshot &snapshot,
+                                 uint32_t timestamp_us) {
+    ATDev_INA220_PackedSample record;
+    uint32_t ticks = (timestamp_us - _last_us) / INA220_PACKED_TICK_US;
+
+    // Advance by whole ticks only so rounding doesn't accumulate
+    _last_us += ticks * INA220_PACKED_TICK_US;
+
+    record.busVoltage_reg = ((uint16_t)snapshot.busVoltage_raw / 4) << 3;
+    if (snapshot.flags & INA220_SAMPLE_CNVR) {
+      record.busVoltage_reg |= INA220_BUSVOLTAGE_CNVR;
+    }
+    if (snapshot.flags & INA220_SAMPLE_OVF) {
+      record.busVoltage_reg |= INA220_BUSVOLTAGE_OVF;
+    }
+    if (ticks > 0xFFFF) {
+      ticks = 0xFFFF;
+      _last_us = timestamp_us;
+      record.busVoltage_reg |= INA220_PACKED_GAP;
+    }
+    record.delta_ticks = ticks;
+    record.shuntVoltage_raw = snapshot.shuntVoltage_raw;
+    record.current_raw = snapshot.current_raw;
+    return record;
+  }
+
+private:
+  uint32_t _last_us;
+};
+
+/*!
+ *  @brief  Turns packed records back into scaled readings, applying the
+ *          calibration off the sampling path
+ */
+class ATDev_INA220_SampleDecoder {
+public:
+  /*!
+   *  @brief  Instantiates a decoder
+   *  @param  currentLSB_nA the current LSB the samples were taken with,
+   *          from ATDev_INA220::getCurrentLSB_nA()
+   *  @param  start_us the start time given to the packer
+   */
+  ATDev_INA220_SampleDecoder(uint32_t currentLSB_nA, uint32_t start_us = 0) {
+    _currentLSB_mA = currentLSB_nA / 1000000.0f;
+    _time_us = start_us;
+  }
+
+  /*!
+   *  @brief  Decodes the next record. Records must be decoded in the order
+   *          they were packed.
+   *  @param  record the packed record
+   *  @param  snapshot filled with the raw and scaled readings
+   *  @return the sample's timestamp in us. After a record flagged
+   *          INA220_PACKED_GAP the timestamps are only relative.
+   */
+  uint32_t decode(const ATDev_INA220_PackedSample &record,
+                  ATDev_INA220::Snapshot &snapshot) {
+    uint16_t bus = record.busVoltage_reg;
+    int32_t current = record.current_raw;
+
+    _time_us += (uint32_t)record.delta_ticks * INA220_PACKED_TICK_US;
+
+    snapshot.shuntVoltage_raw = record.shuntVoltage_raw;
+    snapshot.busVoltage_raw = (int16_t)((bus >> 3) * 4);
+    snapshot.current_raw = record.current_raw;
+    // Power = |Current| * BusVoltage / 5000, with the bus voltage in 4mV
+    // bits. The register is unsigned and holds the magnitude.
+    snapshot.power_raw =
+        (uint16_t)(((current < 0 ? -current : current) * (bus >> 3)) / 5000);
+
+    snapshot.shuntVoltage_mV = snapshot.shuntVoltage_raw * 0.01f;
+    snapshot.busVoltage_V = snapshot.busVoltage_raw * 0.001f;
+    snapshot.current_mA = snapshot.current_raw * _currentLSB_mA;
+    snapshot.power_mW = snapshot.power_raw * 20 * _currentLSB_mA;
+
+    snapshot.flags = 0;
+    if (bus & INA220_BUSVOLTAGE_CNVR) {
+      snapshot.flags |= INA220_SAMPLE_CNVR;
+    }
+    if (bus & INA220_BUSVOLTAGE_OVF) {
+      snapshot.flags |= INA220_SAMPLE_OVF;
+    }
+    return _time_us;
+  }
+
+private:
+  float _currentLSB_mA;
+  uint32_t _time_us;
+};
+
+/*!
+ *  @brief  Single-producer/single-consumer ring buffer. One side (e.g. a
+ *          timer interrupt) calls push() while the other (e.g. loop())
+ *          calls pop(), without disabling interrupts: each index is a
+ *          single byte written by one side only, and the barriers make
+ *          sure a record is complete before the other side can see it.
+ *  @tparam T the record type, e.g. ATDev_INA220_Sample
+ *  @tparam N the capacity, a power of two up to 128
+ */
+template <typename T, uint8_t N> class ATDev_INA220_RingBuffer {
+  static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0,
+                "capacity must be a power of two up to 128");
+
+public:
+  /*!
+   *  @brief  Instantiates an empty buffer
+   */
+  ATDev_INA220_RingBuffer() {
+    _head = 0;
+    _tail = 0;
+  }
+
+  /*!
+   *  @brief  Adds a record. Producer side only.
+   *  @param  record the record to add
+   *  @return true: added false: the buffer is full and the record dropped
+   */
+  bool push(const T &record) {
+    uint8_t head = _head;
+    if ((uint8_t)(head - _tail) >= N) {
+      return false;
+    }
+    _records[head & (N - 1)] = record;
+    INA220_MEMORY_BARRIER();
+    _head = head + 1;
+    return true;
+  }
+
+  /*!
+   *  @brief  Removes the oldest record. Consumer side only.
+   *  @param  record set to the oldest record
+   *  @return true: a record was removed false: the buffer is empty
+   */
+  bool pop(T &record) {
+    uint8_t tail = _tail;
+    if (tail == _head) {
+      return false;
+    }
+    INA220_MEMORY_BARRIER();
+    record = _records[tail & (N - 1)];
+    INA220_MEMORY_BARRIER();
+    _tail = tail + 1;
+    return true;
+  }
+
+  /*!
+   *  @brief  Gets the number of records waiting. Exact on the consumer
+   *          side, may grow meanwhile.
+   *  @return the number of records in the buffer
+   */
+  uint8_t size() { return (uint8_t)(_head - _tail); }
+
+  /*!
+   *  @brief  Gets the buffer capacity
+   *  @return N
+   */
+  uint8_t capacity() { return N; }
+
+  /*!
+   *  @brief  Drops all waiting records. Consumer side only.
+   */
+  void clear() { _tail = _head; }
+
+private:
+  T _records[N];
+  volatile uint8_t _head; // written by the producer only
+  volatile uint8_t _tail; // written by the consumer only
+};
+
+#endif
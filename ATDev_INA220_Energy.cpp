@@ -0,0 +1,101 @@
+/*!
+ * @file ATDev_INA220_Energy.cpp
+ *
+ * Charge and energy integration for INA220 readings.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "ATDev_INA220_Energy.h"
+
+/** microseconds per hour **/
+#define US_PER_HOUR (3600000000.0)
+
+/*!
+ *  @brief  Instantiates an accumulator with no samples
+ *  @param  currentLSB_nA the current LSB of the sensor, from
+ *          ATDev_INA220::getCurrentLSB_nA()
+ */
+ATDev_INA220_Energy::ATDev_INA220_Energy(uint32_t currentLSB_nA) {
+  _currentLSB_nA = currentLSB_nA;
+  reset();
+}
+
+/*!
+ *  @brief  Sets the current LSB used to scale the totals. The totals are
+ *          kept in raw units, so reset() after recalibrating the sensor.
+ *  @param  currentLSB_nA the current LSB, from
+ *          ATDev_INA220::getCurrentLSB_nA()
+ */
+void ATDev_INA220_Energy::setCurrentLSB_nA(uint32_t currentLSB_nA) {
+  _currentLSB_nA = currentLSB_nA;
+}
+
+/*!
+ *  @brief  Clears the totals and elapsed time
+ */
+void ATDev_INA220_Energy::reset() {
+  _started = false;
+  _charge = 0;
+  _energy = 0;
+  _elapsed_us = 0;
+}
+
+/*!
+ *  @brief  Adds one sample. The interval since the previous sample is
+ *          integrated with the average of both readings.
+ *  @param  timestamp_us micros() when the sample was read
+ *  @param  current_raw raw current register
+ *  @param  power_raw raw power register
+ */
+void ATDev_INA220_Energy::addSample(uint32_t timestamp_us, int16_t current_raw,
+                                    uint16_t power_raw) {
+  if (_started) {
+    uint32_t dt = timestamp_us - _last_us;
+    _charge += (int64_t)((int32_t)_lastCurrent + current_raw) * dt;
+    _energy += (uint64_t)((uint32_t)_lastPower + power_raw) * dt;
+    _elapsed_us += dt;
+  }
+  _started = true;
+  _last_us = timestamp_us;
+  _lastCurrent = current_raw;
+  _lastPower = power_raw;
+}
+
+/*!
+ *  @brief  Adds one sample
+ *  @param  snapshot the readings
+ *  @param  timestamp_us micros() when the snapshot was read
+ */
+void ATDev_INA220_Energy::addSample(const ATDev_INA220::Snapshot &snapshot,
+                                    uint32_t timestamp_us) {
+  addSample(timestamp_us, snapshot.current_raw, snapshot.power_raw);
+}
+
+/*!
+ *  @brief  Gets the charge that flowed since the first sample
+ *  @return the charge in mAh, negative for reverse current
+ */
+float ATDev_INA220_Energy::getCharge_mAh() {
+  // _charge / 2 * LSB[nA] / 1e6 gives mA * us
+  return (double)_charge * _currentLSB_nA / (2 * 1000000.0 * US_PER_HOUR);
+}
+
+/*!
+ *  @brief  Gets the energy delivered since the first sample
+ *  @return the energy in mWh
+ */
+float ATDev_INA220_Energy::getEnergy_mWh() {
+  // The power LSB is 20 times the current LSB
+  return (double)_energy * 20 * _currentLSB_nA /
+         (2 * 1000000.0 * US_PER_HOUR);
+}
+
+/*!
+ *  @brief  Gets the time covered by the totals
+ *  @return milliseconds between the first and the last sample
+ */
+uint32_t ATDev_INA220_Energy::getElapsed_ms() {
+  return (uint32_t)(_elapsed_us / 1000);
+}
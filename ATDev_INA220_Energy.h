@@ -0,0 +1,48 @@
+/*!
+ * @file ATDev_INA220_Energy.h
+ *
+ * Charge and energy integration for INA220 readings.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _LIB_ATDev_INA220_ENERGY_
+#define _LIB_ATDev_INA220_ENERGY_
+
+#include "ATDev_INA220.h"
+
+/*!
+ *  @brief  Coulomb counter and energy meter. Integrates the raw current
+ *          and power registers over the measured time between samples
+ *          with the trapezoidal rule, in 64-bit integers so long runs
+ *          don't drift. Scaling to mAh/mWh happens only when reading the
+ *          totals.
+ */
+class ATDev_INA220_Energy {
+public:
+  ATDev_INA220_Energy(uint32_t currentLSB_nA = 0);
+  void setCurrentLSB_nA(uint32_t currentLSB_nA);
+  void reset();
+  void addSample(uint32_t timestamp_us, int16_t current_raw,
+                 uint16_t power_raw);
+  void addSample(const ATDev_INA220::Snapshot &snapshot,
+                 uint32_t timestamp_us);
+  float getCharge_mAh();
+  float getEnergy_mWh();
+  uint32_t getElapsed_ms();
+
+private:
+  uint32_t _currentLSB_nA;
+  bool _started;
+  uint32_t _last_us;
+  int16_t _lastCurrent;
+  uint16_t _lastPower;
+  // Sums of (previous + current) reading * microseconds, i.e. twice the
+  // integral in raw LSB * us
+  int64_t _charge;
+  uint64_t _energy;
+  uint64_t _elapsed_us;
+};
+
+#endif
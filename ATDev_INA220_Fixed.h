@@ -0,0 +1,145 @@
+/*!
+ * @file ATDev_INA220_Fixed.h
+ *
+ * Compile-time calibration for INA220 boards whose shunt resistor and
+ * current range never change.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _LIB_ATDev_INA220_FIXED_
+#define _LIB_ATDev_INA220_FIXED_
+
+#include "ATDev_INA220.h"
+
+/*!
+ *  @brief  Rounds a current LSB up to a 1, 2 or 5 step, as
+ *          ATDev_INA220::setCalibration() does
+ *  @param  minimum_nA the smallest LSB that fits the maximum current
+ *  @param  decade_nA the decade to start from
+ *  @return the rounded LSB in nA
+ */
+constexpr uint64_t ATDev_INA220_roundLSB_nA(uint64_t minimum_nA,
+                                            uint64_t decade_nA = 1) {
+  return decade_nA >= minimum_nA       ? decade_nA
+         : 2 * decade_nA >= minimum_nA ? 2 * decade_nA
+         : 5 * decade_nA >= minimum_nA
+             ? 5 * decade_nA
+             : ATDev_INA220_roundLSB_nA(minimum_nA, 10 * decade_nA);
+}
+
+/*!
+ *  @brief  INA220 driver with the calibration computed at compile time.
+ *          The calibration value, range and gain and the scale factors are
+ *          constants, so getCurrent_mA(), getPower_mW() and the snapshot
+ *          reads are a constant multiply and none of the runtime
+ *          calibration code is linked in.
+ *
+ *          E.g. a 2 mOhm shunt measuring up to 40A:
+ *          ATDev_INA220_Fixed<2000, 40000> ina220;
+ *
+ *  @tparam ShuntMicroOhm the shunt resistor value in micro-ohms
+ *  @tparam MaxMilliAmp the largest current to be measured, in mA
+ *  @tparam Range the bus voltage range
+ */
+template <uint32_t ShuntMicroOhm, uint32_t MaxMilliAmp,
+          INA220_BusVoltageRange Range = INA220_CONFIG_BVOLTAGERANGE_32V>
+class ATDev_INA220_Fixed : public ATDev_INA220 {
+public:
+  /** maximum shunt voltage in uV (uOhm * mA = nV) **/
+  static constexpr uint32_t shuntVoltageMax_uV =
+      (uint32_t)(((uint64_t)ShuntMicroOhm * MaxMilliAmp) / 1000);
+
+  /** smallest PGA range that fits the maximum shunt voltage **/
+  static constexpr uint16_t gain =
+      shuntVoltageMax_uV <= 40000    ? INA220_CONFIG_GAIN_1_40MV
+      : shuntVoltageMax_uV <= 80000  ? INA220_CONFIG_GAIN_2_80MV
+      : shuntVoltageMax_uV <= 160000 ? INA220_CONFIG_GAIN_4_160MV
+                                     : INA220_CONFIG_GAIN_8_320MV;
+
+  /** MinimumLSB = MaxExpected_I / 32767 in nA, rounded up **/
+  static constexpr uint64_t currentLSBMin_nA =
+      ((uint64_t)MaxMilliAmp * 1000000 + 32766) / 32767;
+
+  /** Cal = trunc (0.04096 / (Current_LSB * RSHUNT)) before clamping, for
+   *  the minimum LSB rounded up to a 1, 2 or 5 step **/
+  static constexpr uint64_t calExact =
+      40960000000000ULL /
+      (ATDev_INA220_roundLSB_nA(currentLSBMin_nA) * ShuntMicroOhm);
+
+  /** calibration register value, bit 0 always zero **/
+  static constexpr uint16_t calValue =
+      (uint16_t)((calExact > 65534 ? 65534 : calExact) & 0xFFFE);
+
+  /** config word for this calibration, without the ADC settings **/
+  static constexpr uint16_t config =
+      Range | gain | INA220_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
+
+  /** current LSB in mA that the truncated calValue gives **/
+  static constexpr float currentLSB_mA =
+      (float)(40960000.0 / ((double)calValue * ShuntMicroOhm));
+
+  /** current LSB in nA, rounded, for the integer API **/
+  static constexpr uint32_t currentLSB_nA =
+      (uint32_t)((40960000000000ULL + (uint64_t)calValue * ShuntMicroOhm / 2) /
+                 ((uint64_t)calValue * ShuntMicroOhm));
+
+  /** power LSB in mW (PowerLSB = 20 * CurrentLSB) **/
+  static constexpr float powerLSB_mW = 20 * currentLSB_mA;
+
+  static_assert(ShuntMicroOhm > 0 && MaxMilliAmp > 0,
+                "shunt and current must be non-zero");
+  static_assert(shuntVoltageMax_uV <= 320000,
+                "maximum current exceeds the 320mV shunt range");
+  static_assert(calValue > 0, "shunt and current can't be calibrated");
+
+  /*!
+   *  @brief  Instantiates a new INA220 with a fixed calibration
+   *  @param addr the I2C address the device can be found on
+   */
+  ATDev_INA220_Fixed(uint8_t addr = INA220_ADDRESS) : ATDev_INA220(addr) {}
+
+  /*!
+   *  @brief  Sets up the HW with the compile-time calibration
+   *  @param theWire the TwoWire object to use
+   *  @return true: success false: Failed to start I2C
+   */
+  bool begin(TwoWire *theWire = &Wire) {
+    if (!beginDevice(theWire)) {
+      return false;
+    }
+    INA220_calValue = calValue;
+    INA220_currentDivider_mA = 1 / currentLSB_mA;
+    INA220_powerMultiplier_mW = powerLSB_mW;
+    INA220_currentLSB_nA = currentLSB_nA;
+    // Keep the ADC resolution set before begin()
+    applyCalibration(config | adcSettings());
+    return true;
+  }
+
+  /*!
+   *  @brief  Gets the current value in mA
+   *  @return the current reading converted to milliamps
+   */
+  float getCurrent_mA() { return getCurrent_raw() * currentLSB_mA; }
+
+  /*!
+   *  @brief  Gets the power value in mW
+   *  @return power reading converted to milliwatts
+   */
+  float getPower_mW() { return getPower_raw() * powerLSB_mW; }
+
+protected:
+  /*!
+   *  @brief  Fills the scaled current and power of a snapshot read with
+   *          readAll(), pollSample() or poll()
+   *  @param  snapshot the snapshot to fill
+   */
+  void scaleCurrentPower(Snapshot &snapshot) override {
+    snapshot.current_mA = snapshot.current_raw * currentLSB_mA;
+    snapshot.power_mW = snapshot.power_raw * powerLSB_mW;
+  }
+};
+
+#endif
@@ -0,0 +1,279 @@
+/*!
+ * @file ATDev_INA220_Log.cpp
+ *
+ * Delta/varint streaming log encoder and decoder for INA220 readings.
+ *
+ * Record layout, all multi-byte values as LEB128 varints, signed values
+ * zig-zag encoded:
+ *
+ *   keyframe: 0xA5 0x20 flags cal config currentLSB_nA timestamp_us
+ *             shunt bus/4 current
+ *   delta:    header dt_us [dshunt] [dbus/4] [dcurrent]
+ *
+ * The delta header is 0x80 | flags << 3 | changed channels; unchanged
+ * channels are omitted, so a steady reading costs two or three bytes.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "ATDev_INA220_Log.h"
+
+/*!
+ *  @brief  Appends an unsigned LEB128 varint
+ *  @param  out where to write
+ *  @param  value the value
+ *  @return the number of bytes written
+ */
+static size_t putVarint(uint8_t *out, uint32_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+/*!
+ *  @brief  Appends a zig-zag encoded signed varint
+ *  @param  out where to write
+ *  @param  value the value
+ *  @return the number of bytes written
+ */
+static size_t putSigned(uint8_t *out, int32_t value) {
+  return putVarint(out, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+/*!
+ *  @brief  Reads an unsigned LEB128 varint
+ *  @param  in the input
+ *  @param  len bytes available
+ *  @param  pos read position, advanced past the varint
+ *  @param  value set to the value
+ *  @return true: read false: input ended or the varint is too long
+ */
+static bool getVarint(const uint8_t *in, size_t len, size_t &pos,
+                      uint32_t &value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (pos >= len) {
+      return false;
+    }
+    uint8_t b = in[pos++];
+    value |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ *  @brief  Reads a zig-zag encoded signed varint
+ *  @param  in the input
+ *  @param  len bytes available
+ *  @param  pos read position, advanced past the varint
+ *  @param  value set to the value
+ *  @return true: read false: input ended or the varint is too long
+ */
+static bool getSigned(const uint8_t *in, size_t len, size_t &pos,
+                      int32_t &value) {
+  uint32_t raw;
+  if (!getVarint(in, len, pos, raw)) {
+    return false;
+  }
+  value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+  return true;
+}
+
+/*!
+ *  @brief  Instantiates an encoder
+ *  @param  keyframeInterval number of samples between keyframes
+ */
+ATDev_INA220_LogEncoder::ATDev_INA220_LogEncoder(uint16_t keyframeInterval) {
+  _keyframeInterval = keyframeInterval ? keyframeInterval : 1;
+  _sinceKeyframe = _keyframeInterval;
+  _last.calValue = 0;
+  _last.config = 0;
+  _last.currentLSB_nA = 0;
+}
+
+/*!
+ *  @brief  Sets the calibration written into keyframes and forces a
+ *          keyframe for the next sample
+ *  @param  calValue the calibration register value
+ *  @param  config the config register value
+ *  @param  currentLSB_nA the current LSB, from
+ *          ATDev_INA220::getCurrentLSB_nA()
+ */
+void ATDev_INA220_LogEncoder::setCalibration(uint16_t calValue,
+                                             uint16_t config,
+                                             uint32_t currentLSB_nA) {
+  _last.calValue = calValue;
+  _last.config = config;
+  _last.currentLSB_nA = currentLSB_nA;
+  _sinceKeyframe = _keyframeInterval;
+}
+
+/*!
+ *  @brief  Encodes one sample
+ *  @param  timestamp_us micros() when the sample was read
+ *  @param  shuntVoltage_raw raw shunt voltage
+ *  @param  busVoltage_raw bus voltage in mV
+ *  @param  current_raw raw current register
+ *  @param  flags INA220_SAMPLE_CNVR/OVF flags
+ *  @param  out buffer of at least INA220_LOG_MAX_RECORD bytes
+ *  @return the number of bytes written to out
+ */
+size_t ATDev_INA220_LogEncoder::encode(uint32_t timestamp_us,
+                                       int16_t shuntVoltage_raw,
+                                       int16_t busVoltage_raw,
+                                       int16_t current_raw, uint8_t flags,
+                                       uint8_t *out) {
+  size_t n = 0;
+  flags &= 0x03;
+
+  if (_sinceKeyframe >= _keyframeInterval) {
+    _sinceKeyframe = 0;
+    out[n++] = INA220_LOG_SYNC0;
+    out[n++] = INA220_LOG_SYNC1;
+    out[n++] = flags;
+    n += putVarint(out + n, _last.calValue);
+    n += putVarint(out + n, _last.config);
+    n += putVarint(out + n, _last.currentLSB_nA);
+    n += putVarint(out + n, timestamp_us);
+    n += putSigned(out + n, shuntVoltage_raw);
+    n += putSigned(out + n, busVoltage_raw / 4);
+    n += putSigned(out + n, current_raw);
+  } else {
+    uint8_t header = INA220_LOG_DELTA | (flags << INA220_LOG_FLAGS_SHIFT);
+    size_t headerPos = n++;
+
+    n += putVarint(out + n, timestamp_us - _last.timestamp_us);
+    if (shuntVoltage_raw != _last.shuntVoltage_raw) {
+      header |= INA220_LOG_SHUNT;
+      n += putSigned(out + n, shuntVoltage_raw - _last.shuntVoltage_raw);
+    }
+    if (busVoltage_raw / 4 != _last.busVoltage_raw / 4) {
+      header |= INA220_LOG_BUS;
+      n += putSigned(out + n, busVoltage_raw / 4 - _last.busVoltage_raw / 4);
+    }
+    if (current_raw != _last.current_raw) {
+      header |= INA220_LOG_CURRENT;
+      n += putSigned(out + n, current_raw - _last.current_raw);
+    }
+    out[headerPos] = header;
+  }
+
+  _sinceKeyframe++;
+  _last.timestamp_us = timestamp_us;
+  _last.shuntVoltage_raw = shuntVoltage_raw;
+  _last.busVoltage_raw = busVoltage_raw;
+  _last.current_raw = current_raw;
+  return n;
+}
+
+/*!
+ *  @brief  Instantiates a decoder, which waits for the first keyframe
+ */
+ATDev_INA220_LogDecoder::ATDev_INA220_LogDecoder() { _synced = false; }
+
+/*!
+ *  @brief  Checks whether a keyframe has been seen, i.e. delta records
+ *          can be decoded
+ *  @return true if synced to the stream
+ */
+bool ATDev_INA220_LogDecoder::synced() { return _synced; }
+
+/*!
+ *  @brief  Tells a record cut off by the end of the input from a varint
+ *          that is too long, which only corrupted data produces
+ *  @param  len bytes available
+ *  @param  pos where reading the varint stopped
+ *  @return 0: wait for more input -1: skip a byte and look for a keyframe
+ */
+int ATDev_INA220_LogDecoder::truncated(size_t len, size_t pos) {
+  if (pos < len) {
+    _synced = false;
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ *  @brief  Decodes the record at the start of the input
+ *  @param  in the input
+ *  @param  len bytes available
+ *  @param  record set to the decoded sample and its calibration
+ *  @return > 0: a record of that many bytes was decoded
+ *          0: the record is incomplete, call again with more input
+ *          < 0: that many bytes were skipped while looking for a keyframe
+ */
+int ATDev_INA220_LogDecoder::decode(const uint8_t *in, size_t len,
+                                    ATDev_INA220_LogRecord &record) {
+  size_t pos = 0;
+  uint32_t u[4];
+  int32_t v[3];
+
+  if (len == 0) {
+    return 0;
+  }
+
+  if (in[0] == INA220_LOG_SYNC0) {
+    if (len < 3) {
+      return 0;
+    }
+    if (in[1] != INA220_LOG_SYNC1 || (in[2] & ~0x03)) {
+      _synced = false;
+      return -1;
+    }
+    pos = 3;
+    for (uint8_t i = 0; i < 4; i++) {
+      if (!getVarint(in, len, pos, u[i])) {
+        return truncated(len, pos);
+      }
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+      if (!getSigned(in, len, pos, v[i])) {
+        return truncated(len, pos);
+      }
+    }
+    _last.flags = in[2];
+    _last.calValue = u[0];
+    _last.config = u[1];
+    _last.currentLSB_nA = u[2];
+    _last.timestamp_us = u[3];
+    _last.shuntVoltage_raw = v[0];
+    _last.busVoltage_raw = v[1] * 4;
+    _last.current_raw = v[2];
+    _synced = true;
+    record = _last;
+    return pos;
+  }
+
+  uint8_t header = in[0];
+  if (!_synced || !(header & INA220_LOG_DELTA) ||
+      (header & INA220_LOG_DELTA_RESERVED)) {
+    _synced = false;
+    return -1;
+  }
+
+  pos = 1;
+  if (!getVarint(in, len, pos, u[0])) {
+    return truncated(len, pos);
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    v[i] = 0;
+    if ((header & (1 << i)) && !getSigned(in, len, pos, v[i])) {
+      return truncated(len, pos);
+    }
+  }
+  _last.flags = (header >> INA220_LOG_FLAGS_SHIFT) & 0x03;
+  _last.timestamp_us += u[0];
+  _last.shuntVoltage_raw += v[0];
+  _last.busVoltage_raw += v[1] * 4;
+  _last.current_raw += v[2];
+  record = _last;
+  return pos;
+}
@@ -0,0 +1,93 @@
+/*!
+ * @file ATDev_INA220_Log.h
+ *
+ * Compact streaming log format for INA220 readings: successive raw
+ * register values are delta-encoded as zig-zag varints, with periodic
+ * keyframes carrying absolute values and the calibration and config
+ * words. Plain C++ without Arduino dependencies so the same code decodes
+ * logs on the host (see extras/ina220_logdecode).
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _LIB_ATDev_INA220_LOG_
+#define _LIB_ATDev_INA220_LOG_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** first byte of a keyframe record **/
+#define INA220_LOG_SYNC0 (0xA5)
+
+/** second byte of a keyframe record **/
+#define INA220_LOG_SYNC1 (0x20)
+
+/** header of a delta record, the low bits say which channels changed
+ *  and carry the sample flags **/
+#define INA220_LOG_DELTA (0x80)
+
+/** mask of the header bits that must be zero in a delta record **/
+#define INA220_LOG_DELTA_RESERVED (0x60)
+
+/** delta record header bits **/
+#define INA220_LOG_SHUNT (0x01)    /**< shunt voltage changed */
+#define INA220_LOG_BUS (0x02)      /**< bus voltage changed */
+#define INA220_LOG_CURRENT (0x04)  /**< current changed */
+#define INA220_LOG_FLAGS_SHIFT (3) /**< CNVR/OVF flags in bits 3-4 */
+
+/** largest encoded record in bytes **/
+#define INA220_LOG_MAX_RECORD (32)
+
+/*!
+ *  @brief  One logged sample plus the calibration it was taken with
+ */
+struct ATDev_INA220_LogRecord {
+  uint32_t timestamp_us;    /**< micros() when the sample was read */
+  int16_t shuntVoltage_raw; /**< raw shunt voltage, 10uV per bit */
+  int16_t busVoltage_raw;   /**< bus voltage in mV */
+  int16_t current_raw;      /**< raw current register */
+  uint8_t flags;            /**< INA220_SAMPLE_* CNVR/OVF flags */
+  uint16_t calValue;        /**< calibration register value */
+  uint16_t config;          /**< config register value */
+  uint32_t currentLSB_nA;   /**< current LSB, the power LSB is 20x this */
+};
+
+/*!
+ *  @brief  Encodes samples into the log format. A keyframe is emitted for
+ *          the first sample, after setCalibration() and every
+ *          keyframeInterval samples, so a reader can join the stream at
+ *          any keyframe.
+ */
+class ATDev_INA220_LogEncoder {
+public:
+  ATDev_INA220_LogEncoder(uint16_t keyframeInterval = 256);
+  void setCalibration(uint16_t calValue, uint16_t config,
+                      uint32_t currentLSB_nA);
+  size_t encode(uint32_t timestamp_us, int16_t shuntVoltage_raw,
+                int16_t busVoltage_raw, int16_t current_raw, uint8_t flags,
+                uint8_t *out);
+
+private:
+  ATDev_INA220_LogRecord _last;
+  uint16_t _keyframeInterval;
+  uint16_t _sinceKeyframe;
+};
+
+/*!
+ *  @brief  Decodes a log stream record by record
+ */
+class ATDev_INA220_LogDecoder {
+public:
+  ATDev_INA220_LogDecoder();
+  int decode(const uint8_t *in, size_t len, ATDev_INA220_LogRecord &record);
+  bool synced();
+
+private:
+  int truncated(size_t len, size_t pos);
+
+  ATDev_INA220_LogRecord _last;
+  bool _synced;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*!
+ * @file ATDev_INA220_Scheduler.h
+ *
+ * Conversion-aware read scheduling for several INA220s on one bus.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _LIB_ATDev_INA220_SCHEDULER_
+#define _LIB_ATDev_INA220_SCHEDULER_
+
+#include "ATDev_INA220.h"
+
+/*!
+ *  @brief  Orders reads of up to N INA220s so each one is read just after
+ *          its conversion completes. Every device is polled for CNVR at
+ *          its expected conversion boundary, taken from its config word;
+ *          a poll that finds no new data retries after an eighth of the
+ *          conversion period, so the schedule locks onto each device's
+ *          own conversion cycle. Devices never block each other: service()
+ *          performs at most one read per call.
+ *  @tparam N the maximum number of devices
+ */
+template <uint8_t N> class ATDev_INA220_Scheduler {
+public:
+  /*!
+   *  @brief  Instantiates an empty scheduler
+   */
+  ATDev_INA220_Scheduler() { _count = 0; }
+
+  /*!
+   *  @brief  Adds a device that has already been set up with begin()
+   *  @param  device the device to schedule
+   *  @return the device's index, -1 if the scheduler is full
+   */
+  int8_t add(ATDev_INA220 *device) {
+    if (_count >= N) {
+      return -1;
+    }
+    _entries[_count].device = device;
+    _entries[_count].due = micros();
+    return _count++;
+  }
+
+  /*!
+   *  @brief  Makes every device due immediately, e.g. after changing ADC
+   *          settings
+   */
+  void restart() {
+    uint32_t now = micros();
+    for (uint8_t i = 0; i < _count; i++) {
+      _entries[i].due = now;
+    }
+  }
+
+  /*!
+   *  @brief  Reads the most overdue device, if any device is due
+   *  @param  snapshot filled with the device's readings
+   *  @return the index of the device whose new conversion was read, -1 if
+   *          no device was due, none had new data or the read failed
+   */
+  int8_t service(ATDev_INA220::Snapshot &snapshot) {
+    uint32_t now = micros();
+    int8_t next = -1;
+    int32_t most_overdue = 0;
+
+    for (uint8_t i = 0; i < _count; i++) {
+      int32_t overdue = (int32_t)(now - _entries[i].due);
+      if (overdue >= most_overdue) {
+        most_overdue = overdue;
+        next = i;
+      }
+    }
+    if (next < 0) {
+      return -1;
+    }
+
+    Entry &entry = _entries[next];
+    uint32_t period = entry.device->getConversionTime_us();
+    if (period == 0) {
+      // ADC is off, check back in a while in case that changes
+      entry.due = now + 100000UL;
+      return -1;
+    }
+
+    if (entry.device->pollSample(snapshot)) {
+      // The next conversion completes a period after this one. Advancing
+      // from the due time, not from when the read happened, keeps reads
+      // delayed by the bus or by other devices from pushing the schedule
+      // later every cycle. Resync if more than a period behind.
+      entry.due += period;
+      if ((int32_t)(now - entry.due) >= 0) {
+        entry.due = now + period;
+      }
+      return next;
+    }
+
+    if (!entry.device->success()) {
+      entry.due = now + period;
+    } else {
+      entry.due = now + period / 8;
+    }
+    return -1;
+  }
+
+  /*!
+   *  @brief  Gets the time until the next device is due, so callers can
+   *          sleep or do other work in between
+   *  @return microseconds until the next read, 0 if one is due now
+   */
+  uint32_t timeUntilNext_us() {
+    uint32_t now = micros();
+    uint32_t wait = 0xFFFFFFFF;
+
+    for (uint8_t i = 0; i < _count; i++) {
+      int32_t left = (int32_t)(_entries[i].due - now);
+      if (left <= 0) {
+        return 0;
+      }
+      if ((uint32_t)left < wait) {
+        wait = left;
+      }
+    }
+    return _count ? wait : 0;
+  }
+
+private:
+  /*!
+   *  @brief  A scheduled device and the time its next conversion is due
+   */
+  struct Entry {
+    ATDev_INA220 *device; /**< the device */
+    uint32_t due;         /**< micros() of the expected conversion */
+  };
+
+  Entry _entries[N];
+  uint8_t _count;
+};
+
+#endif
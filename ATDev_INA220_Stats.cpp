@@ -0,0 +1,138 @@
+/*!
+ * @file ATDev_INA220_Stats.cpp
+ *
+ * Streaming statistics over raw INA220 readings.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include <math.h>
+
+#include "ATDev_INA220_Stats.h"
+
+/*!
+ *  @brief  Instantiates an empty accumulator
+ */
+ATDev_INA220_Stats::ATDev_INA220_Stats() { reset(); }
+
+/*!
+ *  @brief  Starts a new window
+ */
+void ATDev_INA220_Stats::reset() {
+  _count = 0;
+  _min = 0;
+  _max = 0;
+  _shift = 0;
+  _sum = 0;
+  _sumSq = 0;
+}
+
+/*!
+ *  @brief  Adds one sample
+ *  @param  raw the raw reading, a 16 bit register value
+ */
+void ATDev_INA220_Stats::addSample(int32_t raw) {
+  if (_count == 0) {
+    _shift = raw;
+    _min = raw;
+    _max = raw;
+  } else if (raw < _min) {
+    _min = raw;
+  } else if (raw > _max) {
+    _max = raw;
+  }
+
+  // Both values are 16 bit, so the square of the difference fits 32 bits
+  uint32_t diff = raw >= _shift ? raw - _shift : _shift - raw;
+  _sum += raw - _shift;
+  _sumSq += diff * diff;
+  _count++;
+}
+
+/*!
+ *  @brief  Gets the number of samples in the window
+ *  @return the sample count
+ */
+uint32_t ATDev_INA220_Stats::getCount() { return _count; }
+
+/*!
+ *  @brief  Gets the smallest sample in the window
+ *  @return the minimum, 0 if the window is empty
+ */
+int32_t ATDev_INA220_Stats::getMin() { return _min; }
+
+/*!
+ *  @brief  Gets the largest sample in the window
+ *  @return the maximum, 0 if the window is empty
+ */
+int32_t ATDev_INA220_Stats::getMax() { return _max; }
+
+/*!
+ *  @brief  Gets the spread of the samples in the window
+ *  @return the maximum minus the minimum
+ */
+int32_t ATDev_INA220_Stats::getPeakToPeak() { return _max - _min; }
+
+/*!
+ *  @brief  Gets the mean of the window
+ *  @return the mean in raw units, 0 if the window is empty
+ */
+float ATDev_INA220_Stats::getMean() {
+  if (_count == 0) {
+    return 0;
+  }
+  return _shift + (double)_sum / _count;
+}
+
+/*!
+ *  @brief  Gets the population variance of the window
+ *  @return the variance in raw units squared
+ */
+float ATDev_INA220_Stats::getVariance() {
+  if (_count == 0) {
+    return 0;
+  }
+  double mean = (double)_sum / _count;
+  double variance = (double)_sumSq / _count - mean * mean;
+  return variance > 0 ? variance : 0;
+}
+
+/*!
+ *  @brief  Gets the standard deviation of the window
+ *  @return the standard deviation in raw units
+ */
+float ATDev_INA220_Stats::getStdDev() { return sqrt(getVariance()); }
+
+/*!
+ *  @brief  Gets the root mean square of the window, e.g. the RMS current
+ *          of a pulsed load
+ *  @return the RMS in raw units
+ */
+float ATDev_INA220_Stats::getRMS() {
+  float mean = getMean();
+  return sqrt(getVariance() + mean * mean);
+}
+
+/*!
+ *  @brief  Adds the readings of one snapshot
+ *  @param  snapshot the readings
+ */
+void ATDev_INA220_ChannelStats::addSample(
+    const ATDev_INA220::Snapshot &snapshot) {
+  shuntVoltage.addSample(snapshot.shuntVoltage_raw);
+  busVoltage.addSample(snapshot.busVoltage_raw);
+  current.addSample(snapshot.current_raw);
+  // The power register is unsigned
+  power.addSample(snapshot.power_raw);
+}
+
+/*!
+ *  @brief  Starts a new window on all channels
+ */
+void ATDev_INA220_ChannelStats::reset() {
+  shuntVoltage.reset();
+  busVoltage.reset();
+  current.reset();
+  power.reset();
+}
@@ -0,0 +1,61 @@
+/*!
+ * @file ATDev_INA220_Stats.h
+ *
+ * Streaming statistics over raw INA220 readings.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _LIB_ATDev_INA220_STATS_
+#define _LIB_ATDev_INA220_STATS_
+
+#include "ATDev_INA220.h"
+
+/*!
+ *  @brief  Min, max, mean, variance and RMS of one channel, in raw register
+ *          units. Each sample costs a few integer operations: the sums are
+ *          kept relative to the first sample of the window, which keeps
+ *          them exact and small like Welford's method without a division
+ *          per sample. Everything else is computed when read.
+ */
+class ATDev_INA220_Stats {
+public:
+  ATDev_INA220_Stats();
+  void reset();
+  void addSample(int32_t raw);
+  uint32_t getCount();
+  int32_t getMin();
+  int32_t getMax();
+  int32_t getPeakToPeak();
+  float getMean();
+  float getVariance();
+  float getStdDev();
+  float getRMS();
+
+private:
+  uint32_t _count;
+  int32_t _min;
+  int32_t _max;
+  int32_t _shift;
+  int64_t _sum;    // sum of (raw - _shift)
+  uint64_t _sumSq; // sum of (raw - _shift)^2
+};
+
+/*!
+ *  @brief  Statistics for all four channels of one INA220. Values are raw:
+ *          shunt in 10uV, bus in mV, current in current LSBs and power in
+ *          20 current LSBs, see ATDev_INA220::getCurrentLSB_nA().
+ */
+class ATDev_INA220_ChannelStats {
+public:
+  void addSample(const ATDev_INA220::Snapshot &snapshot);
+  void reset();
+
+  ATDev_INA220_Stats shuntVoltage; /**< raw shunt voltage */
+  ATDev_INA220_Stats busVoltage;   /**< bus voltage in mV */
+  ATDev_INA220_Stats current;      /**< raw current */
+  ATDev_INA220_Stats power;        /**< raw power */
+};
+
+#endif
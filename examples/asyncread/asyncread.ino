@@ -0,0 +1,57 @@
+// INA220 asynchronous reads
+//
+// Reads snapshots one bus transaction at a time with startRead() and
+// poll(), so the loop keeps servicing other work (here a blinking LED)
+// between the steps of each read instead of blocking for all of them.
+
+#include <Wire.h>
+#include <ATDev_INA220.h>
+
+ATDev_INA220 INA220;
+ATDev_INA220::Snapshot snapshot;
+uint32_t lastBlink = 0;
+
+void setup(void)
+{
+  Serial.begin(115200);
+  while (!Serial) {
+      // will pause Zero, Leonardo, etc until serial console opens
+      delay(1);
+  }
+  pinMode(LED_BUILTIN, OUTPUT);
+
+  if (! INA220.begin()) {
+    Serial.println("Failed to find INA220 chip");
+    while (1) { delay(10); }
+  }
+
+  // Only fetch the other registers when a new conversion is ready
+  INA220.startRead(true);
+}
+
+void loop(void)
+{
+  switch (INA220.poll(snapshot)) {
+  case INA220_ASYNC_PENDING:
+    break;
+  case INA220_ASYNC_READY:
+    if (snapshot.flags & INA220_SAMPLE_CNVR) {
+      Serial.print("Bus Voltage:   "); Serial.print(snapshot.busVoltage_V); Serial.println(" V");
+      Serial.print("Current:       "); Serial.print(snapshot.current_mA); Serial.println(" mA");
+      Serial.print("Power:         "); Serial.print(snapshot.power_mW); Serial.println(" mW");
+      Serial.println("");
+    }
+    INA220.startRead(true);
+    break;
+  case INA220_ASYNC_ERROR:
+    Serial.println("Read failed");
+    INA220.startRead(true);
+    break;
+  }
+
+  // Other work runs between every bus transaction
+  if (millis() - lastBlink >= 500) {
+    lastBlink = millis();
+    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+  }
+}
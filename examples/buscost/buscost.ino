@@ -0,0 +1,183 @@
+// INA220 bus cost benchmark
+//
+// Calls the public methods of ATDev_INA220 that use the bus and reports how
+// many I2C transactions and bytes each put on the wire, the resulting bus
+// time at 100kHz, 400kHz and 1MHz, and the measured time per call at the
+// current clock. Each call is checked against a transaction budget so
+// changes that make the driver chattier on the bus show up as REGRESSION
+// lines.
+// Finally it compares the driver's direct register transfers with the
+// same read through a temporary Adafruit_BusIO_Register.
+//
+// test/test_buscost.cpp runs the same budgets, per mode and for every
+// public method, against the simulated INA220 on the host.
+
+#include <Wire.h>
+#include <Adafruit_BusIO_Register.h>
+#include <ATDev_INA220.h>
+
+// Exposes the driver's raw register read for compareTransferPaths()
+class ATDev_INA220_Raw : public ATDev_INA220 {
+public:
+  using ATDev_INA220::readRegisterOnce;
+};
+
+ATDev_INA220_Raw INA220;
+
+// Number of calls to average the measured time over.
+#define RUNS 100
+
+// Rough bus time in microseconds: 9 clocks per byte (8 bits + ACK) plus
+// about 2 clocks per transaction for the start and stop conditions.
+uint32_t busTime_us(const ATDev_INA220::BusStats &stats, uint32_t clock) {
+  uint32_t clocks = stats.bytes * 9 + stats.transactions * 2;
+  return (uint32_t)(((uint64_t)clocks * 1000000UL) / clock);
+}
+
+ATDev_INA220::Snapshot snapshot;
+
+struct Benchmark {
+  const char *name;
+  void (*run)();
+  uint32_t budget; // max transactions per call
+};
+
+Benchmark benchmarks[] = {
+  {"setCalibration_ATDev_32V_2A", [] { INA220.setCalibration_ATDev_32V_2A(); }, 2},
+  {"setCalibration_32V_2A", [] { INA220.setCalibration_32V_2A(); }, 2},
+  {"setCalibration_32V_1A", [] { INA220.setCalibration_32V_1A(); }, 2},
+  {"setCalibration_16V_400mA", [] { INA220.setCalibration_16V_400mA(); }, 2},
+  {"setCalibration", [] { INA220.setCalibration(0.1f, 3.2f); }, 2},
+  {"getBusVoltage_V", [] { INA220.getBusVoltage_V(); }, 2},
+  {"getShuntVoltage_mV", [] { INA220.getShuntVoltage_mV(); }, 2},
+  {"getCurrent_mA", [] { INA220.getCurrent_mA(); }, 3},
+  {"getPower_mW", [] { INA220.getPower_mW(); }, 3},
+  {"getShuntVoltage_uV", [] { INA220.getShuntVoltage_uV(); }, 2},
+  {"getBusVoltage_mV", [] { INA220.getBusVoltage_mV(); }, 2},
+  {"getCurrent_uA", [] { INA220.getCurrent_uA(); }, 3},
+  {"getPower_uW", [] { INA220.getPower_uW(); }, 3},
+  {"readAll", [] { INA220.readAll(snapshot); }, 9},
+  {"pollSample", [] { INA220.pollSample(snapshot); }, 9},
+  {"startRead/poll", [] {
+     INA220.startRead();
+     while (INA220.poll(snapshot) == INA220_ASYNC_PENDING) {}
+   }, 9},
+  {"readAll, auto-range", [] {
+     INA220.setAutoRange(true);
+     INA220.readAll(snapshot);
+     INA220.setAutoRange(false);
+   }, 10},
+  {"triggerConversion", [] { INA220.triggerConversion(); }, 1},
+  // Polls the bus voltage until CNVR, one read per millisecond
+  {"waitForConversion", [] { INA220.waitForConversion(); }, 2 * 4},
+  {"setBusADCResolution", [] {
+     INA220.setBusADCResolution(INA220_CONFIG_BADCRES_12BIT);
+   }, 1},
+  {"setShuntADCResolution", [] {
+     INA220.setShuntADCResolution(INA220_CONFIG_SADCRES_12BIT_1S_532US);
+   }, 1},
+  {"verifyCalibration", [] { INA220.verifyCalibration(); }, 2},
+  {"verifyRegisters", [] { INA220.verifyRegisters(); }, 4},
+  {"setGain", [] { INA220.setGain(INA220_CONFIG_GAIN_8_320MV); }, 1},
+  {"powerSave", [] { INA220.powerSave(false); }, 1},
+  {"success", [] { INA220.success(); }, 0},
+};
+
+void runBenchmark(const Benchmark &b) {
+  // Wire cost of a single call
+  INA220.resetBusStats();
+  b.run();
+  ATDev_INA220::BusStats stats = INA220.getBusStats();
+
+  // Average time per call on this board at the current clock
+  uint32_t start = micros();
+  for (int i = 0; i < RUNS; i++) {
+    b.run();
+  }
+  uint32_t measured = (micros() - start) / RUNS;
+
+  Serial.print(b.name);
+  Serial.print(": ");
+  Serial.print(stats.transactions); Serial.print(" transactions, ");
+  Serial.print(stats.bytes); Serial.print(" bytes, ");
+  Serial.print(busTime_us(stats, 100000)); Serial.print("/");
+  Serial.print(busTime_us(stats, 400000)); Serial.print("/");
+  Serial.print(busTime_us(stats, 1000000));
+  Serial.print(" us @ 100k/400k/1M, measured ");
+  Serial.print(measured); Serial.println(" us");
+  if (stats.transactions > b.budget) {
+    Serial.print("  REGRESSION: budget is ");
+    Serial.print(b.budget); Serial.println(" transactions");
+  }
+}
+
+void runAll() {
+  for (unsigned int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+    runBenchmark(benchmarks[i]);
+  }
+  Serial.println("");
+}
+
+// Time per raw 16-bit register read through the driver's direct transfer
+// and through a temporary Adafruit_BusIO_Register, as the driver used to
+// do for every access. Both put the same bytes on the wire and neither
+// scales the value, so the difference is the transfer path's CPU overhead.
+void compareTransferPaths() {
+  Adafruit_I2CDevice busio_dev(INA220_ADDRESS, &Wire);
+  uint16_t value;
+
+  busio_dev.begin();
+  INA220.setStreamingReads(false);
+
+  uint32_t start = micros();
+  for (int i = 0; i < RUNS; i++) {
+    INA220.readRegisterOnce(INA220_REG_SHUNTVOLTAGE, &value);
+  }
+  uint32_t direct = (micros() - start) / RUNS;
+
+  start = micros();
+  for (int i = 0; i < RUNS; i++) {
+    Adafruit_BusIO_Register shunt_reg =
+        Adafruit_BusIO_Register(&busio_dev, INA220_REG_SHUNTVOLTAGE, 2, MSBFIRST);
+    shunt_reg.read(&value);
+  }
+  uint32_t busio = (micros() - start) / RUNS;
+
+  Serial.println("Register read, direct transfer vs. Adafruit_BusIO_Register:");
+  Serial.print(direct); Serial.print(" us vs. ");
+  Serial.print(busio); Serial.print(" us, ");
+  Serial.print((int32_t)(busio - direct)); Serial.println(" us saved per read");
+}
+
+void setup(void)
+{
+  Serial.begin(115200);
+  while (!Serial) {
+      // will pause Zero, Leonardo, etc until serial console opens
+      delay(1);
+  }
+
+  if (! INA220.begin()) {
+    Serial.println("Failed to find INA220 chip");
+    while (1) { delay(10); }
+  }
+  Wire.setClock(400000);
+
+  Serial.println("Calibration written before every current/power read:");
+  runAll();
+
+  Serial.println("Calibration tracking enabled:");
+  INA220.setCalibrationTracking(true);
+  runAll();
+
+  Serial.println("Calibration tracking and streaming reads enabled:");
+  INA220.setStreamingReads(true);
+  runAll();
+
+  compareTransferPaths();
+}
+
+void loop(void)
+{
+  delay(1000);
+}
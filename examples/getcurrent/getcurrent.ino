@@ -1,7 +1,7 @@
 #include <Wire.h>
-#include <Adafruit_INA220.h>
+#include <ATDev_INA220.h>
 
-Adafruit_INA220 INA220;
+ATDev_INA220 INA220;
 
 
 void setup(void) 
@@ -31,16 +31,19 @@ void setup(void)
 
 void loop(void) 
 {
-  float shuntvoltage = 0;
-  float busvoltage = 0;
-  float current_mA = 0;
+  ATDev_INA220::Snapshot snapshot;
   float loadvoltage = 0;
-  float power_mW = 0;
 
-  shuntvoltage = INA220.getShuntVoltage_mV();
-  busvoltage = INA220.getBusVoltage_V();
-  current_mA = INA220.getCurrent_mA();
-  power_mW = INA220.getPower_mW();
+  // Read shunt, bus, current and power from the same conversion
+  if (! INA220.readAll(snapshot)) {
+    Serial.println("Failed to read INA220");
+    delay(2000);
+    return;
+  }
+  float shuntvoltage = snapshot.shuntVoltage_mV;
+  float busvoltage = snapshot.busVoltage_V;
+  float current_mA = snapshot.current_mA;
+  float power_mW = snapshot.power_mW;
   loadvoltage = busvoltage + (shuntvoltage / 1000);
   
   Serial.print("Bus Voltage:   "); Serial.print(busvoltage); Serial.println(" V");
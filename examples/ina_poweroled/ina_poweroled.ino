@@ -12,7 +12,8 @@
 #include <Adafruit_NeoPixel.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
-#include <Adafruit_INA220.h>
+#include <ATDev_INA220.h>
+#include <ATDev_INA220_Energy.h>
 
 // Configure orientation of the display.
 // 0 = none, 1 = 90 degrees clockwise, 2 = 180 degrees, 3 = 270 degrees CW
@@ -22,12 +23,12 @@
 
 // Create NeoPixel, OLED and INA220 globals.
 Adafruit_SSD1306 display;
-Adafruit_INA220 INA220;
+ATDev_INA220 INA220;
 Adafruit_NeoPixel pixels = Adafruit_NeoPixel(144, NEO_PIN, NEO_GRB + NEO_KHZ800);
 
-// Keep track of total time and milliamp measurements for milliamp-hour computation.
-uint32_t total_sec = 0;
-float total_mA = 0.0;
+// Integrates current over the measured time between updates for
+// milliamp-hour computation.
+ATDev_INA220_Energy energy;
 
 uint8_t counter = 0;
 void pixel_show_and_powerupdate() {
@@ -58,6 +59,7 @@ void setup()   {
   // better precision.
   //INA220.setCalibration_32V_1A();
   //INA220.setCalibration_16V_400mA();
+  energy.setCurrentLSB_nA(INA220.getCurrentLSB_nA());
 
   // Setup the OLED display.
   display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
@@ -180,18 +182,21 @@ uint32_t Wheel(byte WheelPos) {
 
 void update_power_display() {
   // Read voltage and current from INA220.
-  float shuntvoltage = INA220.getShuntVoltage_mV();
-  float busvoltage = INA220.getBusVoltage_V();
-  float current_mA = INA220.getCurrent_mA();
+  ATDev_INA220::Snapshot snapshot;
+  if (!INA220.readAll(snapshot)) {
+    return;
+  }
+  energy.addSample(snapshot, micros());
+  float shuntvoltage = snapshot.shuntVoltage_mV;
+  float busvoltage = snapshot.busVoltage_V;
+  float current_mA = snapshot.current_mA;
 
   // Compute load voltage, power, and milliamp-hours.
   float loadvoltage = busvoltage + (shuntvoltage / 1000);
   float power_mW = loadvoltage * current_mA;
   (void)power_mW;
 
-  total_mA += current_mA;
-  total_sec += 1;
-  float total_mAH = total_mA / 3600.0;
+  float total_mAH = energy.getCharge_mAh();
   (void)total_mAH;
 
   // Update display.
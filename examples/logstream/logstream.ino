@@ -0,0 +1,50 @@
+// INA220 binary log stream
+//
+// Streams every new conversion over Serial in the compact delta/varint log
+// format instead of ASCII floats. A steady reading takes only a few bytes,
+// so many more samples per second fit through the same UART.
+//
+// Decode on the host with the tool in extras/ina220_logdecode:
+//   ina220_logdecode capture.bin > capture.csv
+
+#include <Wire.h>
+#include <ATDev_INA220.h>
+#include <ATDev_INA220_Log.h>
+
+ATDev_INA220 INA220;
+ATDev_INA220_LogEncoder encoder;
+
+void setup(void)
+{
+  Serial.begin(115200);
+  while (!Serial) {
+      // will pause Zero, Leonardo, etc until serial console opens
+      delay(1);
+  }
+
+  if (! INA220.begin()) {
+    while (1) { delay(10); }
+  }
+  Wire.setClock(400000);
+
+  // Read only what's needed for each new conversion
+  INA220.setCalibrationTracking(true);
+  INA220.setStreamingReads(true);
+
+  // Keyframes carry the calibration so the decoder can scale the samples
+  encoder.setCalibration(INA220.getCalibrationValue(), INA220.getConfig(),
+                         INA220.getCurrentLSB_nA());
+}
+
+void loop(void)
+{
+  ATDev_INA220::Snapshot snapshot;
+  uint8_t record[INA220_LOG_MAX_RECORD];
+
+  if (INA220.pollSample(snapshot)) {
+    size_t len = encoder.encode(micros(), snapshot.shuntVoltage_raw,
+                                snapshot.busVoltage_raw, snapshot.current_raw,
+                                snapshot.flags, record);
+    Serial.write(record, len);
+  }
+}
@@ -0,0 +1,52 @@
+// INA220 windowed statistics
+//
+// Accumulates every new conversion into integer statistics and prints the
+// mean, RMS, min and max current once per second instead of every sample.
+
+#include <Wire.h>
+#include <ATDev_INA220.h>
+#include <ATDev_INA220_Stats.h>
+
+ATDev_INA220 INA220;
+ATDev_INA220_ChannelStats stats;
+float currentLSB_mA;
+uint32_t windowStart;
+
+void setup(void)
+{
+  Serial.begin(115200);
+  while (!Serial) {
+      // will pause Zero, Leonardo, etc until serial console opens
+      delay(1);
+  }
+
+  if (! INA220.begin()) {
+    Serial.println("Failed to find INA220 chip");
+    while (1) { delay(10); }
+  }
+
+  // Statistics are kept in raw units, scale them when printing
+  currentLSB_mA = INA220.getCurrentLSB_nA() / 1000000.0;
+  windowStart = millis();
+}
+
+void loop(void)
+{
+  ATDev_INA220::Snapshot snapshot;
+
+  if (INA220.pollSample(snapshot)) {
+    stats.addSample(snapshot);
+  }
+
+  if (millis() - windowStart >= 1000) {
+    windowStart += 1000;
+    Serial.print("Samples:      "); Serial.println(stats.current.getCount());
+    Serial.print("Mean current: "); Serial.print(stats.current.getMean() * currentLSB_mA); Serial.println(" mA");
+    Serial.print("RMS current:  "); Serial.print(stats.current.getRMS() * currentLSB_mA); Serial.println(" mA");
+    Serial.print("Min current:  "); Serial.print(stats.current.getMin() * currentLSB_mA); Serial.println(" mA");
+    Serial.print("Max current:  "); Serial.print(stats.current.getMax() * currentLSB_mA); Serial.println(" mA");
+    Serial.print("Bus voltage:  "); Serial.print(stats.busVoltage.getMean() * 0.001); Serial.println(" V");
+    Serial.println("");
+    stats.reset();
+  }
+}
@@ -0,0 +1,89 @@
+/*!
+ * @file ina220_logdecode.cpp
+ *
+ * Host-side decoder for logs written with ATDev_INA220_LogEncoder. Reads
+ * the binary stream from a file or stdin and prints one CSV line per
+ * sample with the scaled readings.
+ *
+ * Build from this directory with:
+ *   c++ -O2 -I../.. ina220_logdecode.cpp ../../ATDev_INA220_Log.cpp \
+ *       -o ina220_logdecode
+ *
+ * Usage:
+ *   ina220_logdecode [log.bin] > log.csv
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ATDev_INA220_Log.h"
+
+int main(int argc, char **argv) {
+  FILE *in = stdin;
+  uint8_t buffer[4096];
+  size_t len = 0;
+  unsigned long samples = 0, skipped = 0;
+  ATDev_INA220_LogDecoder decoder;
+  ATDev_INA220_LogRecord record;
+
+  if (argc > 1) {
+    in = fopen(argv[1], "rb");
+    if (!in) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  printf("time_us,shunt_mV,bus_V,current_mA,power_mW,cnvr,ovf\n");
+  while (true) {
+    size_t got = fread(buffer + len, 1, sizeof(buffer) - len, in);
+    len += got;
+
+    size_t pos = 0;
+    while (pos < len) {
+      int n = decoder.decode(buffer + pos, len - pos, record);
+      if (n == 0) {
+        if (got == 0) {
+          // input ended inside a record
+          skipped += len - pos;
+          pos = len;
+        }
+        break;
+      }
+      if (n < 0) {
+        skipped += -n;
+        pos += -n;
+        continue;
+      }
+      pos += n;
+      samples++;
+
+      // Power = |Current| * BusVoltage / 5000, as computed by the chip
+      float current_lsb_mA = record.currentLSB_nA / 1000000.0f;
+      long power_raw = labs((long)record.current_raw) *
+                       (record.busVoltage_raw / 4) / 5000;
+      printf("%lu,%.2f,%.3f,%.4f,%.4f,%d,%d\n",
+             (unsigned long)record.timestamp_us,
+             record.shuntVoltage_raw * 0.01f, record.busVoltage_raw * 0.001f,
+             record.current_raw * current_lsb_mA,
+             power_raw * 20 * current_lsb_mA, record.flags & 0x01,
+             (record.flags >> 1) & 0x01);
+    }
+    memmove(buffer, buffer + pos, len - pos);
+    len -= pos;
+
+    if (got == 0) {
+      break;
+    }
+  }
+
+  fprintf(stderr, "%lu samples, %lu bytes skipped\n", samples, skipped);
+  if (in != stdin) {
+    fclose(in);
+  }
+  return 0;
+}
@@ -0,0 +1,292 @@
+/*!
+ * @file INA220Sim.cpp
+ *
+ * Simulated INA220 for host tests.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "INA220Sim.h"
+
+#define SIM_MAX_DEVICES 16
+
+static INA220Sim *devices[SIM_MAX_DEVICES];
+static uint64_t clock_us;
+static uint32_t latency_us;
+
+/** averaged conversion times in us, indexed by the low 3 resolution bits **/
+static const uint32_t averagedTime_us[8] = {532,  1060,  2130,  4260,
+                                            8510, 17020, 34050, 68100};
+/** single-sample conversion times in us for 9..12 bits **/
+static const uint32_t singleTime_us[4] = {84, 148, 276, 532};
+
+static uint32_t adcTime_us(uint16_t bits) {
+  if (bits & 0x8) {
+    return averagedTime_us[bits & 0x7];
+  }
+  return singleTime_us[bits & 0x3];
+}
+
+INA220Sim::INA220Sim(uint8_t address) : _address(address) {
+  for (uint8_t i = 0; i < SIM_MAX_DEVICES; i++) {
+    if (!devices[i]) {
+      devices[i] = this;
+      break;
+    }
+  }
+  transactions = 0;
+  bytes = 0;
+  _shunt_uV = 0;
+  _bus_mV = 0;
+  _failWrites = 0;
+  _failReads = 0;
+  reset();
+}
+
+INA220Sim::~INA220Sim() {
+  for (uint8_t i = 0; i < SIM_MAX_DEVICES; i++) {
+    if (devices[i] == this) {
+      devices[i] = NULL;
+    }
+  }
+}
+
+/*!
+ *  @brief  Sets the voltage across the shunt, latched at the next conversion
+ *  @param  uV the shunt voltage in uV
+ */
+void INA220Sim::setShuntVoltage_uV(int32_t uV) { _shunt_uV = uV; }
+
+/*!
+ *  @brief  Sets the bus voltage, latched at the next conversion
+ *  @param  mV the bus voltage in mV
+ */
+void INA220Sim::setBusVoltage_mV(int32_t mV) { _bus_mV = mV; }
+
+/*!
+ *  @brief  Returns the chip to its power-on state, like a brown-out or
+ *          the RESET bit: CONFIG 0x399F, calibration cleared, pointer at
+ *          CONFIG and a new conversion started
+ */
+void INA220Sim::reset() {
+  for (uint8_t i = 0; i < 6; i++) {
+    _regs[i] = 0;
+  }
+  _regs[0] = 0x399F;
+  _pointer = 0;
+  conversions = 0;
+  restart();
+}
+
+/*!
+ *  @brief  Makes the next writes fail with a NACK
+ *  @param  count the number of write transfers to fail
+ */
+void INA220Sim::failWrites(uint16_t count) { _failWrites = count; }
+
+/*!
+ *  @brief  Makes the next reads fail, returning no data
+ *  @param  count the number of read transfers to fail
+ */
+void INA220Sim::failReads(uint16_t count) { _failReads = count; }
+
+/*!
+ *  @brief  Reads a register without a bus transfer
+ *  @param  reg the register address
+ *  @return the register contents
+ */
+uint16_t INA220Sim::reg(uint8_t reg) {
+  update();
+  return _regs[reg];
+}
+
+/*!
+ *  @brief  Gets the register pointer
+ *  @return the register the next bare read returns
+ */
+uint8_t INA220Sim::pointer() { return _pointer; }
+
+/*!
+ *  @brief  Gets the time of one conversion in the current mode
+ *  @return the shunt plus bus time for the modes that convert both
+ */
+uint32_t INA220Sim::conversionTime_us() {
+  uint16_t config = _regs[0];
+  uint32_t time = 0;
+  if (config & 0x1) {
+    time += adcTime_us((config >> 3) & 0xF);
+  }
+  if (config & 0x2) {
+    time += adcTime_us((config >> 7) & 0xF);
+  }
+  return time;
+}
+
+void INA220Sim::restart() {
+  _regs[2] &= ~0x2;
+  _converting = (_regs[0] & 0x3) != 0;
+  _conversionEnd = clock_us + conversionTime_us();
+}
+
+void INA220Sim::update() {
+  if (!_converting || clock_us < _conversionEnd) {
+    return;
+  }
+  convert();
+  if (_regs[0] & 0x4) {
+    // Continuous: conversions already finished in between were overwritten
+    uint32_t period = conversionTime_us();
+    uint64_t missed = (clock_us - _conversionEnd) / period;
+    conversions += missed;
+    _conversionEnd += (missed + 1) * period;
+  } else {
+    _converting = false;
+  }
+}
+
+void INA220Sim::convert() {
+  uint16_t config = _regs[0];
+  bool overflow = false;
+  conversions++;
+
+  if (config & 0x1) {
+    int32_t fullScale = 4000 << ((config >> 11) & 0x3);
+    int32_t shunt = _shunt_uV / 10;
+    if (shunt > fullScale) {
+      shunt = fullScale;
+    } else if (shunt < -fullScale) {
+      shunt = -fullScale;
+    }
+    _regs[1] = (uint16_t)(int16_t)shunt;
+  }
+  if (config & 0x2) {
+    int32_t bus = _bus_mV / 4;
+    int32_t busMax = (config & 0x2000) ? 8000 : 4000;
+    if (bus < 0) {
+      bus = 0;
+    } else if (bus > busMax) {
+      bus = busMax;
+    }
+    _regs[2] = (uint16_t)(bus << 3);
+  }
+
+  // The math results only update once calibrated
+  if (_regs[5]) {
+    int32_t current = ((int32_t)(int16_t)_regs[1] * _regs[5]) / 4096;
+    if (current > 32767 || current < -32768) {
+      overflow = true;
+      current = current > 0 ? 32767 : -32768;
+    }
+    int32_t power = ((current < 0 ? -current : current) * (_regs[2] >> 3)) /
+                    5000;
+    if (power > 0xFFFF) {
+      overflow = true;
+      power = 0xFFFF;
+    }
+    _regs[4] = (uint16_t)(int16_t)current;
+    _regs[3] = (uint16_t)power;
+  }
+  _regs[2] = (_regs[2] & ~0x3) | 0x2 | (overflow ? 0x1 : 0x0);
+}
+
+void INA220Sim::writeRegister(uint8_t reg, uint16_t value) {
+  if (reg == 0) {
+    if (value & 0x8000) {
+      reset();
+      return;
+    }
+    _regs[0] = value;
+    restart();
+  } else if (reg == 5) {
+    _regs[5] = value & 0xFFFE;
+  }
+}
+
+/*!
+ *  @brief  Handles a write transfer: a pointer byte and optionally a
+ *          register value, MSB first
+ *  @param  buffer the bytes written
+ *  @param  len the number of bytes
+ *  @return false when the transfer is not acknowledged
+ */
+bool INA220Sim::write(const uint8_t *buffer, size_t len) {
+  transactions++;
+  bytes += len + 1;
+  update();
+  if (_failWrites) {
+    _failWrites--;
+    return false;
+  }
+  if (len == 0 || buffer[0] >= 6) {
+    return len == 0;
+  }
+  _pointer = buffer[0];
+  if (len >= 3) {
+    writeRegister(_pointer, ((uint16_t)buffer[1] << 8) | buffer[2]);
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Handles a read transfer of the register at the pointer
+ *  @param  buffer filled with the register, MSB first
+ *  @param  len the number of bytes requested
+ *  @return false when the read fails
+ */
+bool INA220Sim::read(uint8_t *buffer, size_t len) {
+  transactions++;
+  bytes += len + 1;
+  update();
+  if (_failReads) {
+    _failReads--;
+    return false;
+  }
+  uint16_t value = _regs[_pointer];
+  for (size_t i = 0; i < len; i++) {
+    buffer[i] = (i & 1) ? (uint8_t)value : (uint8_t)(value >> 8);
+  }
+  if (_pointer == 3) {
+    _regs[2] &= ~0x2;
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Finds the simulated device at an address
+ *  @param  address the 7-bit I2C address
+ *  @return the device, or NULL when nothing answers at the address
+ */
+INA220Sim *INA220Sim::find(uint8_t address) {
+  for (uint8_t i = 0; i < SIM_MAX_DEVICES; i++) {
+    if (devices[i] && devices[i]->_address == address) {
+      return devices[i];
+    }
+  }
+  return NULL;
+}
+
+/*!
+ *  @brief  Gets the simulated time
+ *  @return microseconds since the test started
+ */
+uint64_t INA220Sim::now_us() { return clock_us; }
+
+/*!
+ *  @brief  Moves the simulated clock forward
+ *  @param  us the time to pass
+ */
+void INA220Sim::advance_us(uint64_t us) { clock_us += us; }
+
+/*!
+ *  @brief  Sets extra time every bus transaction takes, e.g. for a slow
+ *          bus driver or clock stretching
+ *  @param  us the latency per transaction
+ */
+void INA220Sim::setTransactionLatency_us(uint32_t us) { latency_us = us; }
+
+/*!
+ *  @brief  Gets the extra time per bus transaction
+ *  @return the latency in us
+ */
+uint32_t INA220Sim::transactionLatency_us() { return latency_us; }
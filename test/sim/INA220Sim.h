@@ -0,0 +1,73 @@
+/*!
+ * @file INA220Sim.h
+ *
+ * Simulated INA220 for host tests: a register file with the chip's
+ * conversion timing, calculations and reset behaviour, on a simulated I2C
+ * bus with a simulated clock.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _INA220SIM_H_
+#define _INA220SIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ *  @brief  One simulated INA220. Conversions run on the simulated clock
+ *          with the period set by the BADC/SADC and mode bits, and latch
+ *          the inputs set with setShuntVoltage_uV()/setBusVoltage_mV():
+ *          shunt and bus registers clip to their range, CURRENT and POWER
+ *          are computed from the calibration like the chip does, CNVR is
+ *          set at the end of each conversion and cleared by reading POWER
+ *          or writing CONFIG, and OVF flags a current or power overflow.
+ *          ADC resolution only changes the timing, not the values.
+ */
+class INA220Sim {
+public:
+  INA220Sim(uint8_t address = 0x41);
+  ~INA220Sim();
+
+  void setShuntVoltage_uV(int32_t uV);
+  void setBusVoltage_mV(int32_t mV);
+  void reset();
+  void failWrites(uint16_t count);
+  void failReads(uint16_t count);
+  uint16_t reg(uint8_t reg);
+  uint8_t pointer();
+  uint32_t conversionTime_us();
+
+  uint32_t transactions; /**< transfers addressed to this device */
+  uint32_t bytes;        /**< bytes on the wire, address bytes included */
+  uint32_t conversions;  /**< completed conversions */
+
+  // Bus side, called by the Adafruit_I2CDevice stand-in
+  bool write(const uint8_t *buffer, size_t len);
+  bool read(uint8_t *buffer, size_t len);
+
+  static INA220Sim *find(uint8_t address);
+  static uint64_t now_us();
+  static void advance_us(uint64_t us);
+  static void setTransactionLatency_us(uint32_t us);
+  static uint32_t transactionLatency_us();
+
+private:
+  void update();
+  void convert();
+  void restart();
+  void writeRegister(uint8_t reg, uint16_t value);
+
+  uint8_t _address;
+  uint16_t _regs[6];
+  uint8_t _pointer;
+  int32_t _shunt_uV;
+  int32_t _bus_mV;
+  bool _converting;
+  uint64_t _conversionEnd;
+  uint16_t _failWrites;
+  uint16_t _failReads;
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*!
+ * @file Adafruit_BusIO_Register.h
+ *
+ * Stand-in for the Adafruit BusIO register class, 16-bit MSB first only.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _HOST_ADAFRUIT_BUSIO_REGISTER_H_
+#define _HOST_ADAFRUIT_BUSIO_REGISTER_H_
+
+#include "Adafruit_I2CDevice.h"
+
+/*!
+ *  @brief  Register of an I2C device
+ */
+class Adafruit_BusIO_Register {
+public:
+  Adafruit_BusIO_Register(Adafruit_I2CDevice *i2cdevice, uint16_t reg_addr,
+                          uint8_t width = 1, uint8_t byteorder = LSBFIRST)
+      : _dev(i2cdevice), _addr(reg_addr) {
+    (void)width;
+    (void)byteorder;
+  }
+
+  /*!
+   *  @brief  Reads the register
+   *  @param  value set to the register contents
+   *  @return true on success
+   */
+  bool read(uint16_t *value) {
+    uint8_t reg = _addr, buffer[2];
+    if (!_dev->write_then_read(&reg, 1, buffer, 2)) {
+      return false;
+    }
+    *value = ((uint16_t)buffer[0] << 8) | buffer[1];
+    return true;
+  }
+
+  /*!
+   *  @brief  Writes the register
+   *  @param  value the value to write
+   *  @param  numbytes ignored, always 2
+   *  @return true on success
+   */
+  bool write(uint32_t value, uint8_t numbytes = 0) {
+    uint8_t buffer[3] = {(uint8_t)_addr, (uint8_t)(value >> 8),
+                         (uint8_t)value};
+    (void)numbytes;
+    return _dev->write(buffer, 3);
+  }
+
+private:
+  Adafruit_I2CDevice *_dev;
+  uint16_t _addr;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*!
+ * @file Adafruit_I2CDevice.cpp
+ *
+ * I2C device on the simulated bus.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "Adafruit_I2CDevice.h"
+#include "INA220Sim.h"
+
+TwoWire Wire;
+
+Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire)
+    : _addr(addr), _wire(theWire), _begun(false) {}
+
+bool Adafruit_I2CDevice::begin(bool addr_detect) {
+  _wire->begin();
+  _begun = true;
+  return addr_detect ? detected() : true;
+}
+
+bool Adafruit_I2CDevice::detected(void) {
+  INA220Sim *sim = INA220Sim::find(_addr);
+  transfer(0);
+  return sim && sim->write(NULL, 0);
+}
+
+bool Adafruit_I2CDevice::read(uint8_t *buffer, size_t len, bool stop) {
+  INA220Sim *sim = INA220Sim::find(_addr);
+  (void)stop;
+  transfer(len);
+  return sim && sim->read(buffer, len);
+}
+
+bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
+                               const uint8_t *prefix_buffer,
+                               size_t prefix_len) {
+  INA220Sim *sim = INA220Sim::find(_addr);
+  uint8_t data[8];
+  (void)stop;
+  if (prefix_len + len > sizeof(data)) {
+    return false;
+  }
+  if (prefix_len) {
+    memcpy(data, prefix_buffer, prefix_len);
+  }
+  if (len) {
+    memcpy(data + prefix_len, buffer, len);
+  }
+  transfer(prefix_len + len);
+  return sim && sim->write(data, prefix_len + len);
+}
+
+bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer,
+                                         size_t write_len, uint8_t *read_buffer,
+                                         size_t read_len, bool stop) {
+  return write(write_buffer, write_len, stop) &&
+         read(read_buffer, read_len, true);
+}
+
+// Address plus data bytes, 9 clocks each, and a start and stop condition
+void Adafruit_I2CDevice::transfer(size_t len) {
+  uint64_t clocks = (len + 1) * 9 + 2;
+  INA220Sim::advance_us((clocks * 1000000 + _wire->getClock() - 1) /
+                            _wire->getClock() +
+                        INA220Sim::transactionLatency_us());
+}
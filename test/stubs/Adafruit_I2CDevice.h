@@ -0,0 +1,40 @@
+/*!
+ * @file Adafruit_I2CDevice.h
+ *
+ * Stand-in for the Adafruit BusIO I2C device. Transfers go to the
+ * INA220Sim at the device's address and take simulated bus time.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _HOST_ADAFRUIT_I2CDEVICE_H_
+#define _HOST_ADAFRUIT_I2CDEVICE_H_
+
+#include "Wire.h"
+
+/*!
+ *  @brief  I2C device on the simulated bus
+ */
+class Adafruit_I2CDevice {
+public:
+  Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire = &Wire);
+  uint8_t address(void) { return _addr; }
+  bool begin(bool addr_detect = true);
+  bool detected(void);
+  bool read(uint8_t *buffer, size_t len, bool stop = true);
+  bool write(const uint8_t *buffer, size_t len, bool stop = true,
+             const uint8_t *prefix_buffer = NULL, size_t prefix_len = 0);
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len,
+                       bool stop = false);
+
+private:
+  void transfer(size_t len);
+
+  uint8_t _addr;
+  TwoWire *_wire;
+  bool _begun;
+};
+
+#endif
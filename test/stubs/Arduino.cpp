@@ -0,0 +1,22 @@
+/*!
+ * @file Arduino.cpp
+ *
+ * Arduino timing functions on the simulated clock.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "Arduino.h"
+#include "INA220Sim.h"
+
+uint32_t millis() { return (uint32_t)(INA220Sim::now_us() / 1000); }
+
+uint32_t micros() { return (uint32_t)INA220Sim::now_us(); }
+
+void delay(uint32_t ms) { INA220Sim::advance_us((uint64_t)ms * 1000); }
+
+void delayMicroseconds(uint32_t us) { INA220Sim::advance_us(us); }
+
+// Busy-wait loops must see time pass
+void yield() { INA220Sim::advance_us(1); }
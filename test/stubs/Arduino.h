@@ -0,0 +1,30 @@
+/*!
+ * @file Arduino.h
+ *
+ * Minimal stand-in for the Arduino core so the driver builds on the host.
+ * Time is simulated, see INA220Sim.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+#endif
@@ -0,0 +1,40 @@
+/*!
+ * @file Wire.h
+ *
+ * Stand-in for the Arduino TwoWire class. Only the bus clock is kept, the
+ * simulated transfer time depends on it.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _HOST_WIRE_H_
+#define _HOST_WIRE_H_
+
+#include "Arduino.h"
+
+/*!
+ *  @brief  Simulated I2C bus
+ */
+class TwoWire {
+public:
+  TwoWire() { _clock = 100000; }
+  void begin() {}
+  /*!
+   *  @brief  Sets the bus clock
+   *  @param  clock the clock in Hz
+   */
+  void setClock(uint32_t clock) { _clock = clock; }
+  /*!
+   *  @brief  Gets the bus clock
+   *  @return the clock in Hz
+   */
+  uint32_t getClock() { return _clock; }
+
+private:
+  uint32_t _clock;
+};
+
+extern TwoWire Wire;
+
+#endif
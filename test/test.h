@@ -0,0 +1,54 @@
+/*!
+ * @file test.h
+ *
+ * Minimal checks for the host tests. Each test is its own executable and
+ * returns non-zero from main() when a check failed.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+#include <stdio.h>
+
+static int testFailures;
+
+/** fails the test when the condition is false **/
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      testFailures++;                                                          \
+    }                                                                          \
+  } while (0)
+
+/** fails the test when the two integer values differ **/
+#define CHECK_EQ(actual, expected)                                             \
+  do {                                                                         \
+    long long _a = (long long)(actual), _e = (long long)(expected);            \
+    if (_a != _e) {                                                            \
+      fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__,          \
+              __LINE__, #actual, _a, _e);                                      \
+      testFailures++;                                                          \
+    }                                                                          \
+  } while (0)
+
+/** fails the test when the two float values differ by more than tolerance **/
+#define CHECK_NEAR(actual, expected, tolerance)                                \
+  do {                                                                         \
+    double _a = (actual), _e = (expected);                                     \
+    if (_a < _e - (tolerance) || _a > _e + (tolerance)) {                      \
+      fprintf(stderr, "%s:%d: %s is %g, expected %g\n", __FILE__, __LINE__,    \
+              #actual, _a, _e);                                                \
+      testFailures++;                                                          \
+    }                                                                          \
+  } while (0)
+
+/** exit code for main() **/
+#define TEST_RESULT()                                                          \
+  (testFailures ? (fprintf(stderr, "%d check(s) failed\n", testFailures), 1)   \
+                : 0)
+
+#endif
@@ -0,0 +1,97 @@
+/*!
+ * @file test_alloc.cpp
+ *
+ * Checks that the drivers never allocate from the heap, across repeated
+ * begin() and teardown cycles and every read path.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include <new>
+#include <stdlib.h>
+#include <type_traits>
+
+#include "ATDev_INA220.h"
+#include "ATDev_INA220_Array.h"
+#include "ATDev_INA220_Fixed.h"
+#include "INA220Sim.h"
+#include "test.h"
+
+static_assert(!std::is_copy_constructible<ATDev_INA220>::value,
+              "a copy would share the original's I2C device");
+static_assert(!std::is_copy_assignable<ATDev_INA220>::value,
+              "a copy would share the original's I2C device");
+
+static unsigned long allocations;
+
+void *operator new(size_t size) {
+  allocations++;
+  void *p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete[](void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+static void useDevice(ATDev_INA220 &ina220) {
+  ATDev_INA220::Snapshot snapshot;
+
+  ina220.setCalibration(0.1f, 2.0f);
+  ina220.setCalibrationTracking(true);
+  ina220.setStreamingReads(true);
+  ina220.setAutoRange(true);
+  delay(2);
+  ina220.readAll(snapshot);
+  ina220.getCurrent_mA();
+  ina220.getPower_uW();
+  ina220.startRead();
+  while (ina220.poll(snapshot) == INA220_ASYNC_PENDING) {
+  }
+  ina220.verifyRegisters();
+}
+
+int main() {
+  INA220Sim sim(INA220_ADDRESS), sim2(0x40);
+  sim.setShuntVoltage_uV(12340);
+  sim.setBusVoltage_mV(12000);
+
+  // The counter sees allocations
+  delete new int;
+  CHECK_EQ(allocations, 1);
+
+  allocations = 0;
+  for (int i = 0; i < 100; i++) {
+    ATDev_INA220 ina220;
+    CHECK(ina220.begin());
+    useDevice(ina220);
+    // begin() again reuses the I2C device built in place
+    CHECK(ina220.begin());
+    useDevice(ina220);
+
+    ATDev_INA220_Fixed<100000, 2000> fixed;
+    CHECK(fixed.begin());
+    useDevice(fixed);
+
+    ATDev_INA220_Array<4> array;
+    CHECK_EQ(array.begin(), 2);
+    ATDev_INA220::Snapshot snapshots[4];
+    array.readAll(snapshots);
+
+    // A missing device fails without allocating either
+    ATDev_INA220 missing(0x4F);
+    CHECK(missing.begin() == false);
+  }
+  CHECK_EQ(allocations, 0);
+  return TEST_RESULT();
+}
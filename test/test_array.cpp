@@ -0,0 +1,83 @@
+/*!
+ * @file test_array.cpp
+ *
+ * Runs ATDev_INA220_Array against simulated INA220s: begin() with custom
+ * addresses after a default begin(), and readNext()'s round-robin order,
+ * skipping of missing devices and failed reads.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "ATDev_INA220_Array.h"
+#include "INA220Sim.h"
+#include "test.h"
+
+static void testAddresses() {
+  INA220Sim first(0x41), second(0x45);
+  ATDev_INA220_Array<2> array;
+
+  // The default addresses 0x40 and 0x41 find one device
+  CHECK_EQ(array.begin(), 1);
+  CHECK(!array.present(0));
+  CHECK(array.present(1));
+
+  // Moving both devices rebuilds their I2C objects at the new addresses
+  static const uint8_t addresses[] = {0x45, 0x41};
+  CHECK_EQ(array.begin(&Wire, addresses), 2);
+  CHECK(array.present(0));
+  CHECK(array.present(1));
+
+  first.setBusVoltage_mV(5000);
+  second.setBusVoltage_mV(12000);
+  delayMicroseconds(array[0].getConversionTime_us() + 1);
+  CHECK_EQ(array[0].getBusVoltage_mV(), 12000);
+  CHECK_EQ(array[1].getBusVoltage_mV(), 5000);
+}
+
+static void testReadNext() {
+  INA220Sim first(0x40), third(0x42);
+  ATDev_INA220_Array<3> array;
+  ATDev_INA220::Snapshot snapshot;
+
+  first.setBusVoltage_mV(3300);
+  third.setBusVoltage_mV(12000);
+  CHECK_EQ(array.begin(), 2);
+  delayMicroseconds(array[0].getConversionTime_us() + 1);
+
+  // Device 1 at 0x41 is missing and skipped
+  for (uint8_t round = 0; round < 2; round++) {
+    CHECK_EQ(array.readNext(snapshot), 0);
+    CHECK_EQ(snapshot.busVoltage_raw, 3300);
+    CHECK_EQ(array.readNext(snapshot), 2);
+    CHECK_EQ(snapshot.busVoltage_raw, 12000);
+  }
+
+  // A failed read returns -1 and moves on to the next device
+  first.failReads(1);
+  CHECK_EQ(array.readNext(snapshot), -1);
+  CHECK_EQ(array[0].getStatus(), INA220_STATUS_SHORT_READ);
+  CHECK_EQ(array.readNext(snapshot), 2);
+  CHECK_EQ(snapshot.busVoltage_raw, 12000);
+  CHECK_EQ(array.readNext(snapshot), 0);
+  CHECK_EQ(snapshot.busVoltage_raw, 3300);
+
+  ATDev_INA220::Snapshot snapshots[3];
+  CHECK_EQ(array.readAll(snapshots), 2);
+  CHECK_EQ(snapshots[2].busVoltage_raw, 12000);
+}
+
+static void testNoDevices() {
+  ATDev_INA220_Array<2> array;
+  ATDev_INA220::Snapshot snapshot;
+
+  CHECK_EQ(array.begin(), 0);
+  CHECK_EQ(array.readNext(snapshot), -1);
+}
+
+int main() {
+  testAddresses();
+  testReadNext();
+  testNoDevices();
+  return TEST_RESULT();
+}
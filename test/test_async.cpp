@@ -0,0 +1,250 @@
+/*!
+ * @file test_async.cpp
+ *
+ * Checks the asynchronous read state machine, startRead()/poll(), on a
+ * simulated bus with a slow transaction latency.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "ATDev_INA220.h"
+#include "INA220Sim.h"
+#include "test.h"
+
+/** simulated time every bus transaction takes on top of the wire time **/
+#define LATENCY_US 500
+
+static INA220Sim sim;
+static ATDev_INA220 ina220;
+
+/*!
+ *  @brief  Completes the read started by startRead()
+ *  @param  snapshot the snapshot to fill
+ *  @param  polls set to the number of poll() calls
+ *  @return the last poll() result
+ */
+static INA220_AsyncStatus pollToEnd(ATDev_INA220::Snapshot &snapshot,
+                                    uint32_t &polls) {
+  INA220_AsyncStatus status;
+  polls = 0;
+  do {
+    uint32_t transactions = sim.transactions;
+    uint64_t start = INA220Sim::now_us();
+    status = ina220.poll(snapshot);
+    polls++;
+    // One transaction per step, so a step never blocks for longer
+    CHECK(sim.transactions - transactions <= 1);
+    CHECK(INA220Sim::now_us() - start < 2 * LATENCY_US);
+  } while (status == INA220_ASYNC_PENDING && polls < 100);
+  return status;
+}
+
+static void conversionReady() {
+  delayMicroseconds(ina220.getConversionTime_us() + 1);
+}
+
+static void testMatchesReadAll(bool tracking, bool streaming) {
+  ATDev_INA220::Snapshot async, sync;
+  uint32_t polls;
+
+  ina220.setCalibrationTracking(tracking);
+  ina220.setStreamingReads(streaming);
+  conversionReady();
+  ina220.startRead();
+  CHECK_EQ(pollToEnd(async, polls), INA220_ASYNC_READY);
+  CHECK(ina220.success());
+  CHECK_EQ(polls, ina220.getBusStats().transactions);
+  conversionReady();
+  CHECK(ina220.readAll(sync));
+
+  CHECK_EQ(async.shuntVoltage_raw, sync.shuntVoltage_raw);
+  CHECK_EQ(async.busVoltage_raw, sync.busVoltage_raw);
+  CHECK_EQ(async.current_raw, sync.current_raw);
+  CHECK_EQ(async.power_raw, sync.power_raw);
+  CHECK_EQ(async.flags, sync.flags);
+  CHECK_EQ(async.range, sync.range);
+  CHECK_NEAR(async.current_mA, sync.current_mA, 0.001);
+  CHECK_NEAR(async.power_mW, sync.power_mW, 0.001);
+}
+
+static void testOnlyIfReady() {
+  ATDev_INA220::Snapshot snapshot;
+  uint32_t polls;
+
+  // Slow conversions, so no new one completes during the reads
+  ina220.setCalibrationTracking(true);
+  ina220.setBusADCResolution(INA220_CONFIG_BADCRES_12BIT_128S_69MS);
+  ina220.setShuntADCResolution(INA220_CONFIG_SADCRES_12BIT_128S_69MS);
+  conversionReady();
+  ina220.readAll(snapshot);
+
+  // Reading POWER cleared CNVR, so only the bus voltage is read
+  ina220.startRead(true);
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_READY);
+  CHECK(!(snapshot.flags & INA220_SAMPLE_CNVR));
+  CHECK(polls <= 2);
+
+  conversionReady();
+  ina220.startRead(true);
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_READY);
+  CHECK(snapshot.flags & INA220_SAMPLE_CNVR);
+  CHECK_EQ(snapshot.current_raw, 1234);
+
+  ina220.setBusADCResolution(INA220_CONFIG_BADCRES_12BIT);
+  ina220.setShuntADCResolution(INA220_CONFIG_SADCRES_12BIT_1S_532US);
+}
+
+static void testInterleaved() {
+  ATDev_INA220::Snapshot snapshot;
+  INA220_AsyncStatus status;
+  uint32_t polls = 0;
+
+  // Other reads between the steps move the pointer
+  ina220.setCalibrationTracking(true);
+  ina220.setStreamingReads(true);
+  conversionReady();
+  ina220.startRead();
+  do {
+    status = ina220.poll(snapshot);
+    if (polls % 3 == 2) {
+      ina220.getShuntVoltage_uV();
+    }
+  } while (status == INA220_ASYNC_PENDING && ++polls < 100);
+  CHECK_EQ(status, INA220_ASYNC_READY);
+  CHECK_EQ(snapshot.busVoltage_raw, 12000);
+  CHECK_EQ(snapshot.shuntVoltage_raw, 1234);
+  CHECK_EQ(snapshot.current_raw, 1234);
+}
+
+static void testCalibrationRestore() {
+  ATDev_INA220::Snapshot snapshot;
+  uint32_t polls;
+
+  // A reset clears the calibration; the zero current read finds it
+  ina220.setCalibrationTracking(true, 0);
+  ina220.setStreamingReads(false);
+  sim.reset();
+  conversionReady();
+  ina220.startRead();
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_READY);
+  CHECK_EQ(sim.reg(INA220_REG_CALIBRATION), ina220.getCalibrationValue());
+  CHECK_EQ(sim.reg(INA220_REG_CONFIG), ina220.getConfig());
+
+  conversionReady();
+  ina220.startRead();
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_READY);
+  CHECK_EQ(snapshot.current_raw, 1234);
+}
+
+static void testStreamingAfterReset() {
+  ATDev_INA220::Snapshot snapshot;
+  uint32_t polls;
+
+  // Streamed steps that read the power-on config word are read again
+  ina220.setCalibrationTracking(true, 0);
+  ina220.setStreamingReads(true);
+  conversionReady();
+  ina220.getBusVoltage_mV();
+  sim.reset();
+  ina220.startRead();
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_READY);
+  // The slow steps outlast the first conversion after the reset
+  CHECK_EQ(snapshot.busVoltage_raw, 12000);
+  CHECK_EQ(snapshot.shuntVoltage_raw, 1234);
+  ina220.setCalibration_32V_2A();
+}
+
+static void testErrors() {
+  ATDev_INA220::Snapshot snapshot;
+  uint32_t polls;
+
+  // No read started
+  CHECK_EQ(ina220.poll(snapshot), INA220_ASYNC_ERROR);
+
+  ina220.setCalibrationTracking(true);
+  conversionReady();
+  ina220.startRead();
+  sim.failReads(1);
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_ERROR);
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_SHORT_READ);
+  CHECK_EQ(ina220.poll(snapshot), INA220_ASYNC_ERROR);
+
+  ina220.startRead();
+  sim.failWrites(1);
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_ERROR);
+  CHECK_EQ(polls, 1);
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_NACK);
+
+  // A new read recovers
+  ina220.startRead();
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_READY);
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_OK);
+
+  // Write steps aren't retried either, each poll() stays one transaction
+  ina220.setRetries(3);
+  ina220.setCalibrationTracking(false);
+  conversionReady();
+  ina220.startRead();
+  CHECK_EQ(ina220.poll(snapshot), INA220_ASYNC_PENDING);
+  CHECK_EQ(ina220.poll(snapshot), INA220_ASYNC_PENDING);
+  sim.failWrites(10);
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_ERROR);
+  CHECK_EQ(polls, 1);
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_NACK);
+  sim.failWrites(0);
+  ina220.setRetries(0);
+}
+
+static void testBlockingCallBetweenSteps() {
+  ATDev_INA220::Snapshot snapshot;
+  uint32_t polls;
+
+  // A blocking call that fails between steps reports its own error,
+  // which doesn't leak into the read's status
+  conversionReady();
+  ina220.startRead();
+  CHECK_EQ(ina220.poll(snapshot), INA220_ASYNC_PENDING);
+  sim.failReads(1);
+  ina220.getBusVoltage_mV();
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_SHORT_READ);
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_READY);
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_OK);
+
+  // While the chip NACKs the read fails on its own write step
+  ina220.startRead();
+  CHECK_EQ(ina220.poll(snapshot), INA220_ASYNC_PENDING);
+  sim.failWrites(100);
+  ina220.setCalibration_32V_2A();
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_NACK);
+  CHECK_EQ(pollToEnd(snapshot, polls), INA220_ASYNC_ERROR);
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_NACK);
+
+  // and a blocking call that succeeds afterwards doesn't erase the
+  // failed read's status
+  sim.failWrites(0);
+  CHECK_EQ(ina220.getBusVoltage_mV(), 12000);
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_OK);
+  CHECK_EQ(ina220.poll(snapshot), INA220_ASYNC_ERROR);
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_NACK);
+}
+
+int main() {
+  sim.setShuntVoltage_uV(12340);
+  sim.setBusVoltage_mV(12000);
+  CHECK(ina220.begin());
+  ina220.setCalibration_32V_2A();
+  INA220Sim::setTransactionLatency_us(LATENCY_US);
+
+  for (int mode = 0; mode < 3; mode++) {
+    ina220.resetBusStats();
+    testMatchesReadAll(mode > 0, mode > 1);
+  }
+  testOnlyIfReady();
+  testInterleaved();
+  testCalibrationRestore();
+  testStreamingAfterReset();
+  testErrors();
+  testBlockingCallBetweenSteps();
+  return TEST_RESULT();
+}
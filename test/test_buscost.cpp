@@ -0,0 +1,249 @@
+/*!
+ * @file test_buscost.cpp
+ *
+ * Bus cost budgets: calls every public method of ATDev_INA220 against the
+ * simulator, reports the I2C transactions and bytes each call puts on the
+ * wire and the bus time at 100kHz, 400kHz and 1MHz, and fails when a call
+ * exceeds its transaction budget. Runs with calibration written before
+ * every current/power read, with calibration tracking, and with tracking
+ * plus streaming reads. Finally compares the driver's raw register read
+ * with the same read through Adafruit_BusIO_Register. This is the host
+ * version of examples/buscost.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include <chrono>
+
+#include "ATDev_INA220.h"
+#include "Adafruit_BusIO_Register.h"
+#include "INA220Sim.h"
+#include "test.h"
+
+static INA220Sim sim;
+static ATDev_INA220 ina220;
+static ATDev_INA220::Snapshot snapshot;
+
+/** driver modes the budgets are given for **/
+enum { LEGACY, TRACKING, STREAMING, MODE_COUNT };
+
+static const char *modeNames[MODE_COUNT] = {
+    "calibration written before every current/power read",
+    "calibration tracking", "calibration tracking and streaming reads"};
+
+/*!
+ *  @brief  One public method, how to set the chip up for it and how many
+ *          transactions one call may take in each mode
+ */
+struct Benchmark {
+  const char *name;            /**< the call being measured */
+  void (*setup)();             /**< run before the call, not counted */
+  void (*run)();               /**< the call */
+  uint32_t budget[MODE_COUNT]; /**< max transactions per call */
+};
+
+static int mode;
+
+static void noSetup() {}
+
+static void readCurrent() { ina220.getCurrent_mA(); }
+
+/** lets the current conversion finish so CNVR is set **/
+static void conversionReady() {
+  delayMicroseconds(ina220.getConversionTime_us() + 1);
+}
+
+static void triggered() {
+  ina220.triggerConversion();
+  conversionReady();
+}
+
+static void autoRangeUp() {
+  ina220.setGain(INA220_CONFIG_GAIN_1_40MV);
+  sim.setShuntVoltage_uV(39000);
+  ina220.setAutoRange(true);
+  conversionReady();
+}
+
+static void pollToEnd() {
+  ina220.startRead();
+  while (ina220.poll(snapshot) == INA220_ASYNC_PENDING) {
+  }
+}
+
+static Benchmark benchmarks[] = {
+    {"begin", noSetup, [] { ina220.begin(); }, {2, 2, 2}},
+    {"setCalibration_ATDev_32V_2A", noSetup,
+     [] { ina220.setCalibration_ATDev_32V_2A(); }, {2, 2, 2}},
+    {"setCalibration_32V_2A", noSetup, [] { ina220.setCalibration_32V_2A(); },
+     {2, 2, 2}},
+    {"setCalibration_32V_1A", noSetup, [] { ina220.setCalibration_32V_1A(); },
+     {2, 2, 2}},
+    {"setCalibration_16V_400mA", noSetup,
+     [] { ina220.setCalibration_16V_400mA(); }, {2, 2, 2}},
+    {"setCalibration", noSetup, [] { ina220.setCalibration(0.1f, 3.2f); },
+     {2, 2, 2}},
+    {"getBusVoltage_V", noSetup, [] { ina220.getBusVoltage_V(); }, {2, 2, 2}},
+    {"getShuntVoltage_mV", noSetup, [] { ina220.getShuntVoltage_mV(); },
+     {2, 2, 2}},
+    {"getCurrent_mA", noSetup, [] { ina220.getCurrent_mA(); }, {3, 2, 2}},
+    {"getPower_mW", noSetup, [] { ina220.getPower_mW(); }, {3, 2, 2}},
+    {"getCurrent_mA, repeated", readCurrent,
+     [] { ina220.getCurrent_mA(); }, {3, 2, 1}},
+    {"getShuntVoltage_uV", noSetup, [] { ina220.getShuntVoltage_uV(); },
+     {2, 2, 2}},
+    {"getBusVoltage_mV", noSetup, [] { ina220.getBusVoltage_mV(); },
+     {2, 2, 2}},
+    {"getCurrent_uA", noSetup, [] { ina220.getCurrent_uA(); }, {3, 2, 2}},
+    {"getPower_uW", noSetup, [] { ina220.getPower_uW(); }, {3, 2, 2}},
+    {"getCurrentLSB_nA", noSetup, [] { ina220.getCurrentLSB_nA(); },
+     {0, 0, 0}},
+    {"getCalibrationValue", noSetup, [] { ina220.getCalibrationValue(); },
+     {0, 0, 0}},
+    {"getConfig", noSetup, [] { ina220.getConfig(); }, {0, 0, 0}},
+    {"readAll", conversionReady, [] { ina220.readAll(snapshot); }, {9, 8, 8}},
+    {"pollSample", conversionReady, [] { ina220.pollSample(snapshot); },
+     {9, 8, 8}},
+    {"pollSample, no conversion", noSetup,
+     [] { ina220.pollSample(snapshot); }, {2, 2, 2}},
+    {"startRead/poll", conversionReady, pollToEnd, {9, 8, 7}},
+    {"readAll, auto-range switch", autoRangeUp,
+     [] { ina220.readAll(snapshot); }, {10, 9, 9}},
+    {"setAutoRange", noSetup, [] { ina220.setAutoRange(false); }, {0, 0, 0}},
+    {"triggerConversion", noSetup, [] { ina220.triggerConversion(); },
+     {1, 1, 1}},
+    {"waitForConversion", triggered, [] { ina220.waitForConversion(); },
+     {2, 2, 2}},
+    {"setBusADCResolution", noSetup,
+     [] { ina220.setBusADCResolution(INA220_CONFIG_BADCRES_12BIT); },
+     {1, 1, 1}},
+    {"setShuntADCResolution", noSetup,
+     [] {
+       ina220.setShuntADCResolution(INA220_CONFIG_SADCRES_12BIT_1S_532US);
+     },
+     {1, 1, 1}},
+    {"setGain", noSetup, [] { ina220.setGain(INA220_CONFIG_GAIN_8_320MV); },
+     {1, 1, 1}},
+    {"getConversionTime_us", noSetup, [] { ina220.getConversionTime_us(); },
+     {0, 0, 0}},
+    {"powerSave", noSetup, [] { ina220.powerSave(false); }, {1, 1, 1}},
+    {"verifyCalibration", noSetup, [] { ina220.verifyCalibration(); },
+     {2, 2, 2}},
+    {"verifyRegisters", noSetup, [] { ina220.verifyRegisters(); }, {4, 4, 4}},
+    {"setCalibrationTracking", noSetup,
+     [] { ina220.setCalibrationTracking(mode != LEGACY); }, {0, 0, 0}},
+    {"setStreamingReads", noSetup,
+     [] { ina220.setStreamingReads(mode == STREAMING); }, {0, 0, 0}},
+    {"success", noSetup, [] { ina220.success(); }, {0, 0, 0}},
+    {"getStatus", noSetup, [] { ina220.getStatus(); }, {0, 0, 0}},
+    {"setRetries", noSetup, [] { ina220.setRetries(0); }, {0, 0, 0}},
+    {"getBusStats", noSetup, [] { ina220.getBusStats(); }, {0, 0, 0}},
+    {"resetBusStats", noSetup, [] { ina220.resetBusStats(); }, {0, 0, 0}},
+    {"getFlags", noSetup, [] { ina220.getFlags(); }, {0, 0, 0}},
+    {"getClipStats", noSetup, [] { ina220.getClipStats(); }, {0, 0, 0}},
+    {"resetClipStats", noSetup, [] { ina220.resetClipStats(); }, {0, 0, 0}},
+};
+
+/** rough bus time in us: 9 clocks per byte plus 2 per transaction **/
+static uint32_t busTime_us(const ATDev_INA220::BusStats &stats,
+                           uint32_t clock) {
+  uint32_t clocks = stats.bytes * 9 + stats.transactions * 2;
+  return (uint32_t)(((uint64_t)clocks * 1000000UL) / clock);
+}
+
+static void runBenchmark(const Benchmark &b) {
+  b.setup();
+  ina220.resetBusStats();
+  uint32_t simTransactions = sim.transactions, simBytes = sim.bytes;
+  b.run();
+  ATDev_INA220::BusStats stats = ina220.getBusStats();
+
+  printf("  %-28s %2u transactions, %3u bytes, %4u/%3u/%3u us\n", b.name,
+         (unsigned)stats.transactions, (unsigned)stats.bytes,
+         (unsigned)busTime_us(stats, 100000),
+         (unsigned)busTime_us(stats, 400000),
+         (unsigned)busTime_us(stats, 1000000));
+  if (stats.transactions > b.budget[mode]) {
+    fprintf(stderr, "REGRESSION: %s took %u transactions, budget is %u\n",
+            b.name, (unsigned)stats.transactions, (unsigned)b.budget[mode]);
+    testFailures++;
+  }
+
+  // The driver's accounting must match what reached the chip; begin()
+  // also probes the address, which the driver doesn't count
+  if (b.run != benchmarks[0].run) {
+    CHECK_EQ(sim.transactions - simTransactions, stats.transactions);
+    CHECK_EQ(sim.bytes - simBytes, stats.bytes);
+  }
+}
+
+/** exposes the driver's raw register read **/
+class ATDev_INA220_Raw : public ATDev_INA220 {
+public:
+  using ATDev_INA220::readRegisterOnce;
+};
+
+/*!
+ *  @brief  Compares raw 16-bit reads through the driver's direct transfer
+ *          and through a temporary Adafruit_BusIO_Register: both must put
+ *          the same bytes on the wire and return the same value, so the
+ *          printed host time per read is the transfer path's CPU overhead
+ */
+static void compareTransferPaths() {
+  typedef std::chrono::steady_clock clock;
+  const int runs = 100000;
+  ATDev_INA220_Raw raw;
+  Adafruit_I2CDevice busio_dev(INA220_ADDRESS, &Wire);
+  uint16_t direct = 0, busio = 0;
+
+  CHECK(raw.begin());
+  busio_dev.begin();
+
+  uint32_t transactions = sim.transactions, bytes = sim.bytes;
+  clock::time_point start = clock::now();
+  for (int i = 0; i < runs; i++) {
+    CHECK(raw.readRegisterOnce(INA220_REG_SHUNTVOLTAGE, &direct));
+  }
+  double direct_ns =
+      std::chrono::duration<double, std::nano>(clock::now() - start).count();
+  uint32_t directTransactions = sim.transactions - transactions;
+  uint32_t directBytes = sim.bytes - bytes;
+
+  transactions = sim.transactions;
+  bytes = sim.bytes;
+  start = clock::now();
+  for (int i = 0; i < runs; i++) {
+    Adafruit_BusIO_Register shunt_reg = Adafruit_BusIO_Register(
+        &busio_dev, INA220_REG_SHUNTVOLTAGE, 2, MSBFIRST);
+    CHECK(shunt_reg.read(&busio));
+  }
+  double busio_ns =
+      std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+  CHECK_EQ(directTransactions, sim.transactions - transactions);
+  CHECK_EQ(directBytes, sim.bytes - bytes);
+  CHECK_EQ(direct, busio);
+  printf("raw register read, direct vs. Adafruit_BusIO_Register: %u "
+         "transactions, %u bytes each; %.0f vs. %.0f ns host time\n",
+         (unsigned)(directTransactions / runs), (unsigned)(directBytes / runs),
+         direct_ns / runs, busio_ns / runs);
+}
+
+int main() {
+  Wire.setClock(400000);
+  sim.setShuntVoltage_uV(12340);
+  sim.setBusVoltage_mV(12000);
+  CHECK(ina220.begin());
+
+  for (mode = 0; mode < MODE_COUNT; mode++) {
+    ina220.setCalibrationTracking(mode != LEGACY);
+    ina220.setStreamingReads(mode == STREAMING);
+    printf("%s (us @ 100k/400k/1M):\n", modeNames[mode]);
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+      runBenchmark(benchmarks[i]);
+    }
+  }
+  compareTransferPaths();
+  return TEST_RESULT();
+}
@@ -0,0 +1,51 @@
+/*!
+ * @file test_decoder.cpp
+ *
+ * Round trip of readings from the simulated chip through
+ * ATDev_INA220_SamplePacker and ATDev_INA220_SampleDecoder: the decoder
+ * must recompute the same power register the chip computed.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "ATDev_INA220_Buffer.h"
+#include "INA220Sim.h"
+#include "test.h"
+
+int main() {
+  static const int32_t shunts_uV[] = {0, 12340, -12340, 300000, -300000};
+  static const int32_t buses_mV[] = {0, 5000, 32000, 30000};
+  INA220Sim sim;
+  ATDev_INA220 ina220;
+  ATDev_INA220::Snapshot snapshot, decoded;
+
+  CHECK(ina220.begin());
+  ina220.setCalibration_32V_2A();
+  ATDev_INA220_SamplePacker packer(micros());
+  ATDev_INA220_SampleDecoder decoder(ina220.getCurrentLSB_nA(), micros());
+
+  for (int32_t shunt : shunts_uV) {
+    for (int32_t bus : buses_mV) {
+      sim.setShuntVoltage_uV(shunt);
+      sim.setBusVoltage_mV(bus);
+      delayMicroseconds(ina220.getConversionTime_us() + 1);
+      CHECK(ina220.readAll(snapshot));
+      uint32_t timestamp = micros();
+      decoder.decode(packer.pack(snapshot, timestamp), decoded);
+
+      CHECK_EQ(decoded.shuntVoltage_raw, snapshot.shuntVoltage_raw);
+      CHECK_EQ(decoded.busVoltage_raw, snapshot.busVoltage_raw);
+      CHECK_EQ(decoded.current_raw, snapshot.current_raw);
+      CHECK_EQ(decoded.power_raw, snapshot.power_raw);
+      CHECK_NEAR(decoded.power_mW, snapshot.power_mW, 0.01);
+      CHECK_EQ(decoded.flags & INA220_SAMPLE_CNVR,
+               snapshot.flags & INA220_SAMPLE_CNVR);
+    }
+  }
+
+  // The last sample, -30000 at 30V, wrapped when computed in 16 bits
+  CHECK_EQ(snapshot.current_raw, -30000);
+  CHECK_EQ(decoded.power_raw, 45000);
+  return TEST_RESULT();
+}
@@ -0,0 +1,275 @@
+/*!
+ * @file test_log.cpp
+ *
+ * Round trips through ATDev_INA220_LogEncoder and ATDev_INA220_LogDecoder:
+ * a fixed sequence, resync at the next keyframe after corrupted bytes,
+ * truncated records and a long random walk fed in random chunk sizes.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "ATDev_INA220_Log.h"
+#include "test.h"
+
+/** one sample as handed to the encoder **/
+struct Sample {
+  uint32_t timestamp_us;
+  int16_t shunt, bus, current;
+  uint8_t flags;
+};
+
+/** small deterministic generator so failures reproduce **/
+static uint32_t randomState = 12345;
+static uint32_t random32() {
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 8;
+}
+
+static bool sameSample(const ATDev_INA220_LogRecord &record,
+                       const Sample &sample) {
+  return record.timestamp_us == sample.timestamp_us &&
+         record.shuntVoltage_raw == sample.shunt &&
+         record.busVoltage_raw == sample.bus &&
+         record.current_raw == sample.current && record.flags == sample.flags;
+}
+
+static std::vector<uint8_t> encode(ATDev_INA220_LogEncoder &encoder,
+                                   const std::vector<Sample> &samples,
+                                   std::vector<size_t> *offsets = NULL) {
+  std::vector<uint8_t> stream;
+  uint8_t record[INA220_LOG_MAX_RECORD];
+  for (const Sample &s : samples) {
+    if (offsets) {
+      offsets->push_back(stream.size());
+    }
+    size_t n = encoder.encode(s.timestamp_us, s.shunt, s.bus, s.current,
+                              s.flags, record);
+    CHECK(n > 0 && n <= INA220_LOG_MAX_RECORD);
+    stream.insert(stream.end(), record, record + n);
+  }
+  return stream;
+}
+
+/** decodes a complete stream, returning the records and skipped bytes **/
+static std::vector<ATDev_INA220_LogRecord>
+decodeAll(const std::vector<uint8_t> &stream, size_t *skipped = NULL) {
+  std::vector<ATDev_INA220_LogRecord> records;
+  ATDev_INA220_LogDecoder decoder;
+  ATDev_INA220_LogRecord record;
+  size_t pos = 0;
+
+  if (skipped) {
+    *skipped = 0;
+  }
+  while (pos < stream.size()) {
+    int n = decoder.decode(&stream[pos], stream.size() - pos, record);
+    if (n == 0) {
+      break;
+    }
+    if (n < 0) {
+      pos += -n;
+      if (skipped) {
+        *skipped += -n;
+      }
+      continue;
+    }
+    pos += n;
+    records.push_back(record);
+  }
+  CHECK_EQ(pos, stream.size());
+  return records;
+}
+
+static void testRoundTrip() {
+  static const Sample samples[] = {
+      {1000, 1234, 12000, 2468, 0x01},  {2000, 1234, 12000, 2468, 0x01},
+      {3064, 1240, 12004, 2480, 0x00},  {4100, -32768, 32764, -32768, 0x03},
+      {5100, 32767, 0, 32767, 0x02},    {5100, 0, 4, 0, 0x00},
+      {4294967000u, -1, 8, 1, 0x01},    {300, -2, 16, -2, 0x01},
+  };
+  std::vector<Sample> first(samples, samples + 5);
+  std::vector<Sample> second(samples + 5, samples + 8);
+  ATDev_INA220_LogEncoder encoder;
+
+  encoder.setCalibration(4096, 0x399F, 100000);
+  std::vector<uint8_t> stream = encode(encoder, first);
+  encoder.setCalibration(20480, 0x019F, 1221);
+  std::vector<uint8_t> tail = encode(encoder, second);
+  stream.insert(stream.end(), tail.begin(), tail.end());
+
+  // A steady reading costs the header and the time delta only
+  std::vector<size_t> offsets;
+  ATDev_INA220_LogEncoder steady;
+  encode(steady, first, &offsets);
+  CHECK_EQ(offsets[2] - offsets[1], 3);
+
+  std::vector<ATDev_INA220_LogRecord> records = decodeAll(stream);
+  CHECK_EQ(records.size(), 8);
+  for (size_t i = 0; i < records.size() && i < 8; i++) {
+    CHECK(sameSample(records[i], samples[i]));
+    bool before = i < 5;
+    CHECK_EQ(records[i].calValue, before ? 4096 : 20480);
+    CHECK_EQ(records[i].config, before ? 0x399F : 0x019F);
+    CHECK_EQ(records[i].currentLSB_nA, before ? 100000 : 1221);
+  }
+}
+
+/** a random walk with occasional full scale jumps **/
+static std::vector<Sample> randomSamples(size_t count) {
+  std::vector<Sample> samples;
+  Sample s = {0, 0, 0, 0, 0};
+  for (size_t i = 0; i < count; i++) {
+    uint32_t r = random32();
+    s.timestamp_us += (r & 0x100) ? r % 5000 : 532;
+    if (r % 97 == 0) {
+      s.shunt = (int16_t)random32();
+      s.bus = (int16_t)(random32() % 8192 * 4);
+      s.current = (int16_t)random32();
+    } else {
+      s.shunt += (int16_t)(random32() % 21) - 10;
+      s.bus = (int16_t)((s.bus + (int16_t)(random32() % 3 - 1) * 4) & 0x7FFC);
+      s.current += (int16_t)(random32() % 41) - 20;
+    }
+    s.flags = random32() & 0x03;
+    samples.push_back(s);
+  }
+  return samples;
+}
+
+static void testResync() {
+  ATDev_INA220_LogEncoder encoder(16);
+  std::vector<Sample> samples = randomSamples(64);
+  std::vector<size_t> offsets;
+
+  encoder.setCalibration(4096, 0x399F, 100000);
+  std::vector<uint8_t> stream = encode(encoder, samples, &offsets);
+
+  // A reserved bit in a delta header drops the decoder out of sync until
+  // the keyframe at sample 16, which brings it back with exact values
+  std::vector<uint8_t> corrupted = stream;
+  corrupted[offsets[5]] |= INA220_LOG_DELTA_RESERVED;
+  size_t skipped;
+  std::vector<ATDev_INA220_LogRecord> records = decodeAll(corrupted, &skipped);
+  CHECK_EQ(records.size(), 5 + 48);
+  CHECK_EQ(skipped, offsets[16] - offsets[5]);
+  for (size_t i = 0; i < records.size() && i < 53; i++) {
+    CHECK(sameSample(records[i], samples[i < 5 ? i : i + 11]));
+    CHECK_EQ(records[i].calValue, 4096);
+  }
+
+  // Bytes lost from the middle of the stream: whatever garbage decodes in
+  // between, everything from the next keyframe on is exact
+  corrupted = stream;
+  corrupted.erase(corrupted.begin() + offsets[20] + 1,
+                  corrupted.begin() + offsets[24]);
+  records = decodeAll(corrupted);
+  CHECK(records.size() >= 32);
+  for (size_t i = 0; i < 32 && i < records.size(); i++) {
+    CHECK(sameSample(records[records.size() - 32 + i], samples[32 + i]));
+  }
+
+  // A run of continuation bytes is a broken varint, not a short read,
+  // so the decoder skips it instead of waiting for more input
+  corrupted = stream;
+  corrupted.insert(corrupted.begin() + offsets[40] + 1, 8, 0xFF);
+  records = decodeAll(corrupted);
+  CHECK_EQ(records.size(), 40 + 16);
+  CHECK(sameSample(records.back(), samples.back()));
+}
+
+static void testTruncated() {
+  ATDev_INA220_LogEncoder encoder;
+  std::vector<Sample> samples = randomSamples(2);
+  samples[1].shunt = -12345;
+  samples[1].bus = 32000;
+  samples[1].current = 30000;
+  std::vector<size_t> offsets;
+
+  encoder.setCalibration(4096, 0x399F, 100000);
+  std::vector<uint8_t> stream = encode(encoder, samples, &offsets);
+  offsets.push_back(stream.size());
+
+  // Every prefix of a record asks for more input and leaves the decoder
+  // where it was, so the complete record still decodes afterwards
+  ATDev_INA220_LogDecoder decoder;
+  ATDev_INA220_LogRecord record;
+  for (size_t i = 0; i < 2; i++) {
+    const uint8_t *in = &stream[offsets[i]];
+    size_t len = offsets[i + 1] - offsets[i];
+    for (size_t prefix = 0; prefix < len; prefix++) {
+      CHECK_EQ(decoder.decode(in, prefix, record), 0);
+    }
+    CHECK_EQ(decoder.decode(in, len, record), len);
+    CHECK(sameSample(record, samples[i]));
+    CHECK(decoder.synced());
+  }
+
+  // A delta before any keyframe can't be decoded
+  ATDev_INA220_LogDecoder late;
+  CHECK_EQ(late.decode(&stream[offsets[1]], 1, record), -1);
+  CHECK(!late.synced());
+}
+
+static void testRandomRoundTrip() {
+  ATDev_INA220_LogEncoder encoder(100);
+  ATDev_INA220_LogDecoder decoder;
+  ATDev_INA220_LogRecord record;
+  std::vector<Sample> samples = randomSamples(200000);
+  std::vector<uint16_t> cals;
+  std::vector<uint8_t> stream;
+  uint8_t out[INA220_LOG_MAX_RECORD];
+
+  for (size_t i = 0; i < samples.size(); i++) {
+    const Sample &s = samples[i];
+    if (i % 4999 == 0) {
+      encoder.setCalibration(random32(), random32(), random32());
+    }
+    size_t n =
+        encoder.encode(s.timestamp_us, s.shunt, s.bus, s.current, s.flags, out);
+    stream.insert(stream.end(), out, out + n);
+  }
+
+  // Feed the stream in random chunks, the way ina220_logdecode reads it
+  uint8_t buffer[256];
+  size_t len = 0, pos = 0, next = 0;
+  while (pos < stream.size() || len > 0) {
+    size_t got = 1 + random32() % 64;
+    if (got > stream.size() - pos) {
+      got = stream.size() - pos;
+    }
+    memcpy(buffer + len, &stream[pos], got);
+    pos += got;
+    len += got;
+
+    size_t used = 0;
+    int n;
+    while ((n = decoder.decode(buffer + used, len - used, record)) > 0) {
+      used += n;
+      if (next < samples.size() && !sameSample(record, samples[next])) {
+        CHECK(sameSample(record, samples[next]));
+        break;
+      }
+      next++;
+    }
+    CHECK(n >= 0);
+    if (n < 0 || (pos == stream.size() && used == 0)) {
+      break;
+    }
+    memmove(buffer, buffer + used, len - used);
+    len -= used;
+  }
+  CHECK_EQ(next, samples.size());
+  CHECK_EQ(len, 0);
+}
+
+int main() {
+  testRoundTrip();
+  testResync();
+  testTruncated();
+  testRandomRoundTrip();
+  return TEST_RESULT();
+}
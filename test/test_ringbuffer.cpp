@@ -0,0 +1,83 @@
+/*!
+ * @file test_ringbuffer.cpp
+ *
+ * Stress test for ATDev_INA220_RingBuffer: a producer and a consumer
+ * thread hand over a long sequence of records and the consumer checks
+ * that every record arrives once, in order and not torn.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include <thread>
+
+#include "ATDev_INA220_Buffer.h"
+#include "test.h"
+
+/** records handed over per run **/
+#define RECORDS 2000000UL
+
+/** fills every field from the sequence number so torn records show **/
+static ATDev_INA220_Sample makeSample(uint32_t sequence) {
+  ATDev_INA220_Sample sample;
+  sample.timestamp_us = sequence;
+  sample.shuntVoltage_raw = (int16_t)sequence;
+  sample.busVoltage_raw = (int16_t)(sequence >> 3);
+  sample.current_raw = (int16_t)~sequence;
+  sample.flags = (uint8_t)(sequence >> 16);
+  return sample;
+}
+
+static bool sameSample(const ATDev_INA220_Sample &a,
+                       const ATDev_INA220_Sample &b) {
+  return a.timestamp_us == b.timestamp_us &&
+         a.shuntVoltage_raw == b.shuntVoltage_raw &&
+         a.busVoltage_raw == b.busVoltage_raw &&
+         a.current_raw == b.current_raw && a.flags == b.flags;
+}
+
+template <uint8_t N> static void stress() {
+  static ATDev_INA220_RingBuffer<ATDev_INA220_Sample, N> buffer;
+  unsigned long full = 0, empty = 0, errors = 0;
+
+  std::thread producer([&full] {
+    for (uint32_t i = 0; i < RECORDS; i++) {
+      while (!buffer.push(makeSample(i))) {
+        full++;
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  ATDev_INA220_Sample sample;
+  for (uint32_t i = 0; i < RECORDS; i++) {
+    while (!buffer.pop(sample)) {
+      empty++;
+      std::this_thread::yield();
+    }
+    if (buffer.size() > N) {
+      errors++;
+    }
+    if (!sameSample(sample, makeSample(i))) {
+      if (errors++ < 10) {
+        fprintf(stderr, "capacity %u: record %u arrived as %u\n", N,
+                (unsigned)i, (unsigned)sample.timestamp_us);
+      }
+    }
+  }
+  producer.join();
+
+  printf("capacity %3u: %lu records, producer found it full %lu times, "
+         "consumer found it empty %lu times\n",
+         N, RECORDS, full, empty);
+  CHECK_EQ(errors, 0);
+  CHECK_EQ(buffer.size(), 0);
+  CHECK(buffer.pop(sample) == false);
+}
+
+int main() {
+  stress<1>();
+  stress<4>();
+  stress<128>();
+  return TEST_RESULT();
+}
@@ -0,0 +1,99 @@
+/*!
+ * @file test_scheduler.cpp
+ *
+ * Runs ATDev_INA220_Scheduler against simulated INA220s and checks that it
+ * reads every conversion without falling behind.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "ATDev_INA220_Scheduler.h"
+#include "INA220Sim.h"
+#include "test.h"
+
+/** simulated run time **/
+#define RUN_US 1000000UL
+
+/*!
+ *  @brief  Services the scheduler for RUN_US, sleeping while nothing is due
+ *  @param  scheduler the scheduler
+ *  @param  reads counts the reads per device index
+ */
+template <uint8_t N>
+static void run(ATDev_INA220_Scheduler<N> &scheduler, uint32_t *reads) {
+  ATDev_INA220::Snapshot snapshot;
+  uint64_t end = INA220Sim::now_us() + RUN_US;
+
+  while (INA220Sim::now_us() < end) {
+    int8_t i = scheduler.service(snapshot);
+    if (i >= 0) {
+      reads[i]++;
+    }
+    uint32_t wait = scheduler.timeUntilNext_us();
+    if (wait) {
+      delayMicroseconds(wait);
+    }
+  }
+}
+
+static void testOneDevice() {
+  INA220Sim sim;
+  ATDev_INA220 ina220;
+  ATDev_INA220_Scheduler<1> scheduler;
+  uint32_t reads[1] = {0};
+
+  Wire.setClock(400000);
+  CHECK(ina220.begin());
+  ina220.setCalibrationTracking(true);
+  ina220.setStreamingReads(true);
+  ina220.setBusADCResolution(INA220_CONFIG_BADCRES_12BIT_2S_1060US);
+  CHECK_EQ(ina220.getConversionTime_us(), 1592);
+  scheduler.add(&ina220);
+
+  sim.reg(INA220_REG_CONFIG);
+  uint32_t conversions = sim.conversions;
+  run(scheduler, reads);
+  sim.reg(INA220_REG_CONFIG);
+
+  // Every conversion read, except possibly one completed at the very end
+  printf("1 device: %u reads, %u conversions\n", (unsigned)reads[0],
+         (unsigned)(sim.conversions - conversions));
+  CHECK(reads[0] + 1 >= sim.conversions - conversions);
+  CHECK(reads[0] <= sim.conversions - conversions);
+}
+
+static void testTwoDevices() {
+  INA220Sim sim1(0x40), sim2(0x41);
+  ATDev_INA220 ina1(0x40), ina2(0x41);
+  ATDev_INA220_Scheduler<2> scheduler;
+  uint32_t reads[2] = {0, 0};
+
+  Wire.setClock(400000);
+  CHECK(ina1.begin());
+  CHECK(ina2.begin());
+  ina2.setShuntADCResolution(INA220_CONFIG_SADCRES_12BIT_4S_2130US);
+  CHECK_EQ(scheduler.add(&ina1), 0);
+  CHECK_EQ(scheduler.add(&ina2), 1);
+
+  sim1.reg(INA220_REG_CONFIG);
+  sim2.reg(INA220_REG_CONFIG);
+  uint32_t conversions1 = sim1.conversions, conversions2 = sim2.conversions;
+  run(scheduler, reads);
+  sim1.reg(INA220_REG_CONFIG);
+  sim2.reg(INA220_REG_CONFIG);
+
+  printf("2 devices: %u/%u reads, %u/%u conversions\n", (unsigned)reads[0],
+         (unsigned)reads[1], (unsigned)(sim1.conversions - conversions1),
+         (unsigned)(sim2.conversions - conversions2));
+  CHECK(reads[0] + 1 >= sim1.conversions - conversions1);
+  CHECK(reads[1] + 1 >= sim2.conversions - conversions2);
+  CHECK(reads[0] <= sim1.conversions - conversions1);
+  CHECK(reads[1] <= sim2.conversions - conversions2);
+}
+
+int main() {
+  testOneDevice();
+  testTwoDevices();
+  return TEST_RESULT();
+}
@@ -0,0 +1,275 @@
+/*!
+ * @file test_sim.cpp
+ *
+ * Checks the driver's readings and the simulator's conversion timing.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "ATDev_INA220.h"
+#include "ATDev_INA220_Fixed.h"
+#include "INA220Sim.h"
+#include "test.h"
+
+static void testReadings() {
+  INA220Sim sim;
+  ATDev_INA220 ina220;
+  ATDev_INA220::Snapshot snapshot;
+
+  CHECK(ina220.begin());
+  ina220.setCalibration_32V_2A();
+  sim.setShuntVoltage_uV(12340);
+  sim.setBusVoltage_mV(12000);
+  delay(ina220.getConversionTime_us() / 1000 + 1);
+
+  // 32V_2A: 0.1 ohm shunt, 100uA current LSB, 2mW power LSB
+  CHECK(ina220.readAll(snapshot));
+  CHECK_EQ(snapshot.shuntVoltage_raw, 1234);
+  CHECK_EQ(snapshot.busVoltage_raw, 12000);
+  CHECK_EQ(snapshot.current_raw, 1234);
+  CHECK_EQ(snapshot.power_raw, 1234 * 3000 / 5000);
+  CHECK_NEAR(snapshot.current_mA, 123.4, 0.01);
+  CHECK_NEAR(snapshot.busVoltage_V, 12.0, 0.001);
+  CHECK(snapshot.flags & INA220_SAMPLE_CNVR);
+  CHECK_EQ(ina220.getShuntVoltage_uV(), 12340);
+  CHECK_EQ(ina220.getBusVoltage_mV(), 12000);
+  CHECK_EQ(ina220.getCurrent_uA(), 123400);
+  CHECK_NEAR(ina220.getPower_mW(), 1.48 * 1000, 1);
+
+  // Negative current, power is the magnitude
+  sim.setShuntVoltage_uV(-5000);
+  delay(ina220.getConversionTime_us() / 1000 + 1);
+  CHECK(ina220.readAll(snapshot));
+  CHECK_EQ(snapshot.current_raw, -500);
+  CHECK_EQ(snapshot.power_raw, 500 * 3000 / 5000);
+}
+
+static void testUnsignedPower() {
+  INA220Sim sim;
+  ATDev_INA220 ina220;
+  ATDev_INA220::Snapshot snapshot;
+
+  // 2.67A at 30V is 40000 power LSBs, above the int16_t range
+  CHECK(ina220.begin());
+  ina220.setCalibration_32V_2A();
+  sim.setShuntVoltage_uV(266670);
+  sim.setBusVoltage_mV(30000);
+  delay(ina220.getConversionTime_us() / 1000 + 1);
+
+  CHECK(ina220.readAll(snapshot));
+  CHECK_EQ(snapshot.power_raw, 40000);
+  CHECK_NEAR(snapshot.power_mW, 80000, 1);
+  CHECK_NEAR(ina220.getPower_mW(), 80000, 1);
+  CHECK_EQ(ina220.getPower_uW(), 80000000);
+}
+
+static void testRangeAfterGainSwitch() {
+  INA220Sim sim;
+  ATDev_INA220 ina220;
+  ATDev_INA220::Snapshot snapshot;
+
+  CHECK(ina220.begin());
+  ina220.setCalibration_32V_2A();
+  // Slow conversions, so none completes during a readAll()
+  ina220.setBusADCResolution(INA220_CONFIG_BADCRES_12BIT_128S_69MS);
+  ina220.setShuntADCResolution(INA220_CONFIG_SADCRES_12BIT_128S_69MS);
+  sim.setShuntVoltage_uV(50000);
+  sim.setBusVoltage_mV(12000);
+  delayMicroseconds(ina220.getConversionTime_us() + 1);
+
+  // The registers hold the 320mV conversion until the next one completes
+  ina220.setGain(INA220_CONFIG_GAIN_1_40MV);
+  CHECK(ina220.readAll(snapshot));
+  CHECK_EQ(snapshot.shuntVoltage_raw, 5000);
+  CHECK_EQ(snapshot.range, 3);
+  CHECK(!(snapshot.flags & INA220_SAMPLE_SHUNT_SAT));
+
+  delayMicroseconds(ina220.getConversionTime_us() + 1);
+  CHECK(ina220.readAll(snapshot));
+  CHECK_EQ(snapshot.shuntVoltage_raw, 4000);
+  CHECK_EQ(snapshot.range, 0);
+  CHECK(snapshot.flags & INA220_SAMPLE_SHUNT_SAT);
+
+  // Auto-ranging switches once, and tags the old results with the old range
+  ina220.setAutoRange(true);
+  delayMicroseconds(ina220.getConversionTime_us() + 1);
+  CHECK(ina220.readAll(snapshot));
+  CHECK_EQ(snapshot.range, 0);
+  CHECK_EQ(ina220.getConfig() & INA220_CONFIG_GAIN_MASK,
+           INA220_CONFIG_GAIN_2_80MV);
+  CHECK(ina220.readAll(snapshot));
+  CHECK_EQ(snapshot.range, 0);
+  CHECK_EQ(ina220.getConfig() & INA220_CONFIG_GAIN_MASK,
+           INA220_CONFIG_GAIN_2_80MV);
+
+  // The range also settles without a bus voltage read
+  ina220.setAutoRange(false);
+  ina220.setGain(INA220_CONFIG_GAIN_1_40MV);
+  delayMicroseconds(ina220.getConversionTime_us() + 1);
+  ina220.getShuntVoltage_mV();
+  CHECK(ina220.getFlags() & INA220_SAMPLE_SHUNT_SAT);
+}
+
+static void testStreamingAfterReset() {
+  INA220Sim sim;
+  ATDev_INA220 ina220;
+
+  CHECK(ina220.begin());
+  ina220.setCalibration_32V_2A();
+  ina220.setCalibrationTracking(true, 0);
+  ina220.setStreamingReads(true);
+  sim.setShuntVoltage_uV(12340);
+  sim.setBusVoltage_mV(12000);
+  delayMicroseconds(ina220.getConversionTime_us() + 1);
+  CHECK_NEAR(ina220.getCurrent_mA(), 123.4, 0.01);
+
+  // The reset moves the pointer to CONFIG: the bare read returns 0x399F
+  // and must not be taken for the current
+  sim.reset();
+  ina220.resetBusStats();
+  CHECK_NEAR(ina220.getCurrent_mA(), 0, 0.01);
+  CHECK(ina220.getBusStats().transactions > 1);
+  CHECK_EQ(sim.reg(INA220_REG_CALIBRATION), ina220.getCalibrationValue());
+  delayMicroseconds(ina220.getConversionTime_us() + 1);
+  CHECK_NEAR(ina220.getCurrent_mA(), 123.4, 0.01);
+
+  // The bus voltage register reads 0 until the first conversion
+  CHECK_EQ(ina220.getBusVoltage_mV(), 12000);
+  sim.reset();
+  CHECK_EQ(ina220.getBusVoltage_mV(), 0);
+  CHECK_EQ(sim.pointer(), INA220_REG_BUSVOLTAGE);
+}
+
+static void testConversionTiming() {
+  INA220Sim sim;
+  ATDev_INA220 ina220;
+  ATDev_INA220::Snapshot snapshot;
+
+  CHECK(ina220.begin());
+  ina220.setCalibration_32V_2A();
+  ina220.setBusADCResolution(INA220_CONFIG_BADCRES_12BIT_8S_4260US);
+  ina220.setShuntADCResolution(INA220_CONFIG_SADCRES_9BIT_1S_84US);
+  CHECK_EQ(sim.conversionTime_us(), 4260 + 84);
+  CHECK_EQ(ina220.getConversionTime_us(), 4260 + 84);
+
+  // Nothing is ready until the shunt and bus conversions both finished
+  ina220.pollSample(snapshot);
+  CHECK(ina220.pollSample(snapshot) == false);
+  delayMicroseconds(4260 + 84);
+  CHECK(ina220.pollSample(snapshot));
+  // Reading POWER cleared CNVR
+  CHECK(ina220.pollSample(snapshot) == false);
+
+  // Triggered mode converts once
+  uint32_t before = sim.conversions;
+  CHECK(ina220.triggerConversion());
+  CHECK(ina220.waitForConversion());
+  CHECK_EQ(sim.conversions, before + 1);
+  delay(20);
+  CHECK_EQ(sim.conversions, before + 1);
+}
+
+static void testReset() {
+  INA220Sim sim;
+  ATDev_INA220 ina220;
+
+  CHECK(ina220.begin());
+  ina220.setCalibration_32V_1A();
+  CHECK_EQ(sim.reg(INA220_REG_CALIBRATION), ina220.getCalibrationValue());
+  sim.reset();
+  CHECK_EQ(sim.reg(INA220_REG_CONFIG), 0x399F);
+  CHECK_EQ(sim.reg(INA220_REG_CALIBRATION), 0);
+  CHECK_EQ(sim.pointer(), INA220_REG_CONFIG);
+}
+
+static void testFixedCalibration() {
+  INA220Sim sim;
+  ATDev_INA220_Fixed<100000, 2000> fixed;
+  ATDev_INA220::Snapshot snapshot;
+
+  // Settings made before begin() are kept
+  fixed.setBusADCResolution(INA220_CONFIG_BADCRES_12BIT_4S_2130US);
+  fixed.setShuntADCResolution(INA220_CONFIG_SADCRES_9BIT_1S_84US);
+  CHECK(fixed.begin());
+  CHECK_EQ(sim.reg(INA220_REG_CONFIG),
+           fixed.config | INA220_CONFIG_BADCRES_12BIT_4S_2130US |
+               INA220_CONFIG_SADCRES_9BIT_1S_84US);
+  CHECK_EQ(sim.reg(INA220_REG_CALIBRATION), fixed.calValue);
+
+  sim.setShuntVoltage_uV(-123450);
+  sim.setBusVoltage_mV(12000);
+  delayMicroseconds(fixed.getConversionTime_us() + 1);
+  CHECK(fixed.readAll(snapshot));
+  CHECK(snapshot.current_mA == snapshot.current_raw * fixed.currentLSB_mA);
+  CHECK(snapshot.power_mW == snapshot.power_raw * fixed.powerLSB_mW);
+  CHECK_NEAR(snapshot.current_mA, -1234.5, 0.1);
+  CHECK_NEAR(snapshot.power_mW, 1234.5 * 12, 2);
+}
+
+static void testShuntCalibration() {
+  INA220Sim sim;
+  ATDev_INA220 ina220, preset(0x40);
+  INA220Sim presetSim(0x40);
+
+  // 0.1 Ohm / 2A needs the 320mV range and lands on the preset's 100uA LSB
+  CHECK(preset.begin());
+  preset.setCalibration_32V_2A();
+  CHECK(ina220.begin());
+  CHECK_NEAR(ina220.setCalibration(0.1f, 2.0f), 0.0001, 1e-9);
+  CHECK_EQ(sim.reg(INA220_REG_CALIBRATION), 4096);
+  CHECK_EQ(sim.reg(INA220_REG_CALIBRATION),
+           presetSim.reg(INA220_REG_CALIBRATION));
+  CHECK_EQ(sim.reg(INA220_REG_CONFIG), presetSim.reg(INA220_REG_CONFIG));
+  CHECK_EQ(sim.reg(INA220_REG_CONFIG) & INA220_CONFIG_GAIN_MASK,
+           INA220_CONFIG_GAIN_8_320MV);
+  CHECK_EQ(ina220.getCurrentLSB_nA(), preset.getCurrentLSB_nA());
+
+  // 2mOhm * 40A is exactly 80mV, LSB 40A / 32767 rounded up to 2mA
+  CHECK_NEAR(ina220.setCalibration(0.002f, 40.0f), 0.002, 1e-8);
+  CHECK_EQ(sim.reg(INA220_REG_CALIBRATION), 10240);
+  CHECK_EQ(sim.reg(INA220_REG_CONFIG) & INA220_CONFIG_GAIN_MASK,
+           INA220_CONFIG_GAIN_2_80MV);
+  CHECK_EQ(ina220.getCurrentLSB_nA(), 2000000);
+  CHECK_EQ((ATDev_INA220_Fixed<2000, 40000>::calValue), 10240);
+
+  // 10mOhm * 50A is 500mV, clamped to the 32A the 320mV range measures
+  CHECK_NEAR(ina220.setCalibration(0.01f, 50.0f), 0.001, 1e-8);
+  CHECK_EQ(sim.reg(INA220_REG_CALIBRATION), 4096);
+  CHECK_EQ(sim.reg(INA220_REG_CONFIG) & INA220_CONFIG_GAIN_MASK,
+           INA220_CONFIG_GAIN_8_320MV);
+  CHECK_EQ(ina220.getCurrentLSB_nA(), 1000000);
+
+  // Full scale then reads 32A without overflowing the current register
+  sim.setShuntVoltage_uV(320000);
+  delayMicroseconds(ina220.getConversionTime_us() + 1);
+  CHECK_NEAR(ina220.getCurrent_mA(), 32000, 0.5);
+
+  CHECK_EQ(ina220.setCalibration(0, 1.0f), 0);
+  CHECK_EQ(ina220.setCalibration(0.1f, -1.0f), 0);
+}
+
+static void testMissingDevice() {
+  ATDev_INA220 ina220(0x45);
+  CHECK(ina220.begin() == false);
+  CHECK_EQ(ina220.getStatus(), INA220_STATUS_NACK);
+  CHECK_EQ(ina220.getBusStats().nacks, 1);
+
+  ATDev_INA220_Fixed<100000, 2000> fixed(0x45);
+  CHECK(fixed.begin() == false);
+  CHECK_EQ(fixed.getStatus(), INA220_STATUS_NACK);
+  CHECK_EQ(fixed.getBusStats().nacks, 1);
+}
+
+int main() {
+  testReadings();
+  testUnsignedPower();
+  testRangeAfterGainSwitch();
+  testStreamingAfterReset();
+  testConversionTiming();
+  testReset();
+  testFixedCalibration();
+  testShuntCalibration();
+  testMissingDevice();
+  return TEST_RESULT();
+}